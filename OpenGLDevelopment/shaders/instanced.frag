@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec4 instanceColor;
+in vec2 texCoord;
+flat in uint layer;
+out vec4 FragColor;
+
+// Every instance picks its own image out of one bound texture array
+uniform sampler2DArray layers;
+
+void main()
+{
+   FragColor = instanceColor * texture(layers, vec3(texCoord, float(layer)));
+}
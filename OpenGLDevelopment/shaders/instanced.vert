@@ -0,0 +1,24 @@
+#version 330 core
+#include "uniforms.glsl"
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec4 aInstanceTransform; // offset.xy, scale, rotation
+layout (location = 3) in vec4 aInstanceColor;
+layout (location = 4) in uint aInstanceLayer;
+
+out vec4 instanceColor;
+out vec2 texCoord;
+flat out uint layer;
+
+void main()
+{
+	// Every instance spins at its own starting angle
+	float angle = aInstanceTransform.w + time;
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+	vec2 position = rotation * (aPos.xy * aInstanceTransform.z) + aInstanceTransform.xy;
+	gl_Position = viewProjection * vec4(position, aPos.z, 1.0);
+	instanceColor = aInstanceColor * vec4(aColor, 1.0);
+	texCoord = aPos.xy + 0.5;
+	layer = aInstanceLayer;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+#include "uniforms.glsl"
+
+layout (location = 0) in vec2 aPos; // pixels, origin in the top left corner
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+
+out vec2 texCoord;
+out vec4 spriteColor;
+
+void main()
+{
+	vec2 ndc = aPos * resolution.zw * 2.0 - 1.0;
+	gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+	texCoord = aTexCoord;
+	spriteColor = aColor;
+}
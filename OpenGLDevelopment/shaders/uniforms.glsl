@@ -0,0 +1,18 @@
+// Uniform blocks shared by every program, #include this and the blocks are bound automatically after linking
+// Must match FrameUniforms and CameraUniforms in src/UniformBuffer.h
+
+layout (std140) uniform FrameUniforms
+{
+	float time;
+	float deltaTime;
+	float frameIndex;
+	vec4 resolution; // width, height, 1 / width, 1 / height
+};
+
+layout (std140) uniform CameraUniforms
+{
+	mat4 projection;
+	mat4 view;
+	mat4 viewProjection;
+	vec4 cameraPosition;
+};
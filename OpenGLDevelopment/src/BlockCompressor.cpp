@@ -0,0 +1,378 @@
+#include "BlockCompressor.h"
+
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef BLOCK_COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "CpuProfiler.h"
+#include "GLExtensions.h"
+
+namespace
+{
+	const int MIN_BLOCK_ROWS_PER_THREAD = 8;
+
+	// Gathers a 4x4 block as RGBA, pixels past the right and bottom edges repeat the last column and row
+	void fetch_block(const unsigned char* pixels, int width, int height, int numChannels, int blockX, int blockY, unsigned char* block)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			int y = std::min(blockY * 4 + row, height - 1);
+			for (int column = 0; column < 4; column++)
+			{
+				int x = std::min(blockX * 4 + column, width - 1);
+				const unsigned char* source = pixels + ((size_t)y * width + x) * numChannels;
+				unsigned char* pixel = block + (row * 4 + column) * 4;
+				pixel[0] = 0;
+				pixel[1] = 0;
+				pixel[2] = 0;
+				pixel[3] = 255;
+				memcpy(pixel, source, numChannels);
+			}
+		}
+	}
+
+	void write_u16(unsigned char* output, unsigned int value)
+	{
+		output[0] = (unsigned char)(value & 0xFF);
+		output[1] = (unsigned char)(value >> 8);
+	}
+
+	unsigned int pack_565(const int* color)
+	{
+		return ((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3);
+	}
+
+	void unpack_565(unsigned int packed, int* color)
+	{
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// Per channel minimum and maximum of the 16 RGBA pixels
+	void block_bounds(const unsigned char* block, unsigned char* minimum, unsigned char* maximum)
+	{
+#ifdef BLOCK_COMPRESSOR_SSE2
+		__m128i rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = _mm_loadu_si128((const __m128i*)(block + i * 16));
+		}
+		__m128i low = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+		__m128i high = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+
+		// Fold the 4 pixels in each register down to one
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 8));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+
+		int lowBits = _mm_cvtsi128_si32(low), highBits = _mm_cvtsi128_si32(high);
+		memcpy(minimum, &lowBits, 4);
+		memcpy(maximum, &highBits, 4);
+#else
+		memcpy(minimum, block, 4);
+		memcpy(maximum, block, 4);
+		for (int i = 1; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				minimum[c] = std::min(minimum[c], block[i * 4 + c]);
+				maximum[c] = std::max(maximum[c], block[i * 4 + c]);
+			}
+		}
+#endif
+	}
+
+	// Minimum and maximum of 16 single channel values
+	void value_bounds(const unsigned char* values, int &minimum, int &maximum)
+	{
+#ifdef BLOCK_COMPRESSOR_SSE2
+		__m128i data = _mm_loadu_si128((const __m128i*)values);
+		__m128i low = _mm_min_epu8(data, _mm_srli_si128(data, 8));
+		__m128i high = _mm_max_epu8(data, _mm_srli_si128(data, 8));
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 2));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 2));
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 1));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 1));
+		minimum = _mm_cvtsi128_si32(low) & 0xFF;
+		maximum = _mm_cvtsi128_si32(high) & 0xFF;
+#else
+		minimum = maximum = values[0];
+		for (int i = 1; i < 16; i++)
+		{
+			minimum = std::min(minimum, (int)values[i]);
+			maximum = std::max(maximum, (int)values[i]);
+		}
+#endif
+	}
+
+	// BC1 colour block in 4 colour mode (also the second half of BC3)
+	void encode_color_block(const unsigned char* block, unsigned char* output)
+	{
+		unsigned char low[4], high[4];
+		block_bounds(block, low, high);
+
+		// Pull the corners in by 1/16 of the range, the box corners are usually outliers
+		int minimum[3], maximum[3], center[3];
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (high[c] - low[c]) >> 4;
+			minimum[c] = low[c] + inset;
+			maximum[c] = high[c] - inset;
+			center[c] = (low[c] + high[c]) >> 1;
+		}
+
+		// The box has four diagonals, take the one the colours actually run along (measured against blue)
+		int covarianceRB = 0, covarianceGB = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int blue = block[i * 4 + 2] - center[2];
+			covarianceRB += (block[i * 4 + 0] - center[0]) * blue;
+			covarianceGB += (block[i * 4 + 1] - center[1]) * blue;
+		}
+		if (covarianceRB < 0)
+		{
+			std::swap(minimum[0], maximum[0]);
+		}
+		if (covarianceGB < 0)
+		{
+			std::swap(minimum[1], maximum[1]);
+		}
+
+		// 4 colour mode needs color0 > color1
+		unsigned int color0 = pack_565(maximum), color1 = pack_565(minimum);
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+		write_u16(output, color0);
+		write_u16(output + 2, color1);
+		if (color0 == color1)
+		{
+			memset(output + 4, 0, 4);
+			return;
+		}
+
+		int palette[4][3];
+		unpack_565(color0, palette[0]);
+		unpack_565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		unsigned int indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			const unsigned char* pixel = block + i * 4;
+			int bestIndex = 0, bestDistance = 0x7FFFFFFF;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = pixel[0] - palette[p][0], dg = pixel[1] - palette[p][1], db = pixel[2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= (unsigned int)bestIndex << (i * 2);
+		}
+		write_u16(output + 4, indices & 0xFFFF);
+		write_u16(output + 6, indices >> 16);
+	}
+
+	// BC4 block of one channel in 8 value mode (also the alpha of BC3 and each half of BC5)
+	void encode_value_block(const unsigned char* block, int channel, unsigned char* output)
+	{
+		unsigned char values[16];
+		for (int i = 0; i < 16; i++)
+		{
+			values[i] = block[i * 4 + channel];
+		}
+
+		int minimum, maximum;
+		value_bounds(values, minimum, maximum);
+		output[0] = (unsigned char)maximum;
+		output[1] = (unsigned char)minimum;
+		if (minimum == maximum)
+		{
+			memset(output + 2, 0, 6);
+			return;
+		}
+
+		// Code 0 is the maximum, 1 the minimum and 2-7 step from the maximum down to the minimum
+		int palette[8];
+		palette[0] = maximum;
+		palette[1] = minimum;
+		for (int code = 2; code < 8; code++)
+		{
+			palette[code] = ((8 - code) * maximum + (code - 1) * minimum + 3) / 7;
+		}
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int bestCode = 0, bestDistance = 256;
+			for (int code = 0; code < 8; code++)
+			{
+				int distance = std::abs(values[i] - palette[code]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestCode = code;
+				}
+			}
+			indices |= (unsigned long long)bestCode << (i * 3);
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+}
+
+BlockCompressor::BlockCompressor(unsigned int numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	num_threads = numThreads;
+}
+
+BlockCompressor::~BlockCompressor()
+{
+
+}
+
+void BlockCompressor::compress(const unsigned char* pixels, int width, int height, int numChannels, BlockFormat format, CompressedLevel &level) const
+{
+	CPU_PROFILE_ZONE("Compress texture");
+	level.width = width;
+	level.height = height;
+	level.blocks.resize(levelSize(format, width, height));
+
+	const int blockRows = (height + 3) / 4;
+	const size_t rowSize = levelSize(format, width, 4);
+	const int numBands = std::max(std::min((int)num_threads, blockRows / MIN_BLOCK_ROWS_PER_THREAD), 1);
+
+	// The calling thread takes the first band
+	std::vector<std::thread> threads;
+	for (int band = 1; band < numBands; band++)
+	{
+		int firstRow = blockRows * band / numBands, endRow = blockRows * (band + 1) / numBands;
+		threads.emplace_back(&BlockCompressor::compress_rows, pixels, width, height, numChannels, format, firstRow, endRow,
+			level.blocks.data() + firstRow * rowSize);
+	}
+	compress_rows(pixels, width, height, numChannels, format, 0, blockRows / numBands, level.blocks.data());
+
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void BlockCompressor::compressChain(const unsigned char* pixels, int width, int height, int numChannels, const std::vector<MipLevel> &mips,
+	BlockFormat format, std::vector<CompressedLevel> &levels, unsigned int firstLevel) const
+{
+	levels.assign(mips.size() + 1, CompressedLevel());
+	if (firstLevel == 0)
+	{
+		compress(pixels, width, height, numChannels, format, levels[0]);
+	}
+	for (size_t i = std::max(firstLevel, 1u) - 1; i < mips.size(); i++)
+	{
+		compress(mips[i].pixels.data(), mips[i].width, mips[i].height, numChannels, format, levels[i + 1]);
+	}
+}
+
+BlockFormat BlockCompressor::formatForChannels(int numChannels)
+{
+	switch (numChannels)
+	{
+	case 1: return BLOCK_BC4;
+	case 2: return BLOCK_BC5;
+	case 3: return BLOCK_BC1;
+	default: return BLOCK_BC3;
+	}
+}
+
+int BlockCompressor::channelsForFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BLOCK_BC4: return 1;
+	case BLOCK_BC5: return 2;
+	case BLOCK_BC1: return 3;
+	default: return 4;
+	}
+}
+
+GLenum BlockCompressor::glFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BLOCK_BC1: return GLEXT_COMPRESSED_RGB_S3TC_DXT1;
+	case BLOCK_BC3: return GLEXT_COMPRESSED_RGBA_S3TC_DXT5;
+	case BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+	default: return GL_COMPRESSED_RG_RGTC2;
+	}
+}
+
+bool BlockCompressor::isSupported(BlockFormat format)
+{
+	return format == BLOCK_BC4 || format == BLOCK_BC5 || GLExtensions::hasTextureCompressionS3TC();
+}
+
+size_t BlockCompressor::blockSize(BlockFormat format)
+{
+	return (format == BLOCK_BC1 || format == BLOCK_BC4) ? 8 : 16;
+}
+
+size_t BlockCompressor::levelSize(BlockFormat format, int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+void BlockCompressor::compress_rows(const unsigned char* pixels, int width, int height, int numChannels, BlockFormat format,
+	int firstRow, int endRow, unsigned char* output)
+{
+	const int blocksPerRow = (width + 3) / 4;
+	unsigned char block[64];
+	for (int blockY = firstRow; blockY < endRow; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksPerRow; blockX++)
+		{
+			fetch_block(pixels, width, height, numChannels, blockX, blockY, block);
+			switch (format)
+			{
+			case BLOCK_BC1:
+				encode_color_block(block, output);
+				break;
+			case BLOCK_BC3:
+				encode_value_block(block, 3, output);
+				encode_color_block(block, output + 8);
+				break;
+			case BLOCK_BC4:
+				encode_value_block(block, 0, output);
+				break;
+			case BLOCK_BC5:
+				encode_value_block(block, 0, output);
+				encode_value_block(block, 1, output + 8);
+				break;
+			}
+			output += blockSize(format);
+		}
+	}
+}
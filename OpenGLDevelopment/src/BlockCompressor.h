@@ -0,0 +1,58 @@
+#ifndef BLOCKCOMPRESSOR_H
+#define BLOCKCOMPRESSOR_H
+
+#include <vector>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "MipGenerator.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BLOCK_COMPRESSOR_SSE2
+#endif
+
+enum BlockFormat
+{
+	BLOCK_BC1,	// RGB, 8 bytes per 4x4 block (S3TC DXT1)
+	BLOCK_BC3,	// RGBA, 16 bytes per block, BC4 style alpha followed by a BC1 colour block (S3TC DXT5)
+	BLOCK_BC4,	// R, 8 bytes per block (RGTC1)
+	BLOCK_BC5	// RG, 16 bytes per block, two BC4 blocks (RGTC2)
+};
+
+struct CompressedLevel
+{
+	int width, height;
+	std::vector<unsigned char> blocks;
+};
+
+// Encodes 8 bit images into the block compressed formats every desktop GPU samples natively, at 4:1 to 8:1 of the
+// RGBA8 size. Endpoints come from the (inset) bounding box of each block, computed with SSE2, and every pixel takes
+// the nearest palette entry. Rows of blocks are spread over worker threads that are started per call, which is meant
+// for offline conversion and for loader threads where the start-up cost disappears next to the encode itself.
+// Channels map like the uncompressed upload does: R, RG, RGB, RGBA, with missing colour channels 0 and alpha 255
+class BlockCompressor
+{
+public:
+	BlockCompressor(unsigned int numThreads = 0);	// 0 picks one thread per hardware thread
+	~BlockCompressor();
+
+	void compress(const unsigned char* pixels, int width, int height, int numChannels, BlockFormat format, CompressedLevel &level) const;
+	void compressChain(const unsigned char* pixels, int width, int height, int numChannels, const std::vector<MipLevel> &mips,
+		BlockFormat format, std::vector<CompressedLevel> &levels, unsigned int firstLevel = 0) const;	// levels before firstLevel stay empty
+
+	static BlockFormat formatForChannels(int numChannels);	// BC4, BC5, BC1, BC3
+	static int channelsForFormat(BlockFormat format);
+	static GLenum glFormat(BlockFormat format);
+	static bool isSupported(BlockFormat format);	// BC1 and BC3 need S3TC, call GLExtensions::load first
+	static size_t blockSize(BlockFormat format);
+	static size_t levelSize(BlockFormat format, int width, int height);
+
+private:
+	unsigned int num_threads;
+
+	static void compress_rows(const unsigned char* pixels, int width, int height, int numChannels, BlockFormat format,
+		int firstRow, int endRow, unsigned char* output);
+};
+
+#endif // !BLOCKCOMPRESSOR_H
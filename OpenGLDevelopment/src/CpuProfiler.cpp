@@ -0,0 +1,143 @@
+#include "CpuProfiler.h"
+
+#include <fstream>
+#include <iostream>
+
+std::vector<CpuProfiler::ThreadBuffer*> CpuProfiler::thread_buffers;
+unsigned int CpuProfiler::num_threads = 0;
+std::mutex CpuProfiler::registry_mutex;
+
+namespace
+{
+	void write_json_string(std::ofstream &out, const std::string &str)
+	{
+		out << '"';
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out << '\\';
+			}
+			out << c;
+		}
+		out << '"';
+	}
+}
+
+void CpuProfiler::record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds)
+{
+	ThreadBuffer* buffer = get_thread_buffer();
+
+	uint64_t index = buffer->write_count.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);	// a dump that sees this event's stores also sees write_count == index
+	Event &event = buffer->events[index & (EVENTS_PER_THREAD - 1)];
+	event.name = name;
+	event.start = startNanoseconds;
+	event.duration = endNanoseconds - startNanoseconds;
+	buffer->write_count.store(index + 1, std::memory_order_release);
+}
+
+// Names the calling thread in the trace viewer
+void CpuProfiler::setThreadName(const std::string &name)
+{
+	ThreadBuffer* buffer = get_thread_buffer();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	buffer->thread_name = name;
+}
+
+// Writes the events currently held by every thread's ring buffer as complete ("X") trace events
+bool CpuProfiler::writeChromeTrace(const std::string &filePath)
+{
+	std::ofstream out(filePath, std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cout << "Failed to open " << filePath << " for writing" << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	std::vector<Event> events;
+	for (ThreadBuffer* buffer : thread_buffers)
+	{
+		if (!buffer->thread_name.empty())
+		{
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_ID << ",\"args\":{\"name\":";
+			write_json_string(out, buffer->thread_name);
+			out << "}}";
+			first = false;
+		}
+
+		// Copy the ring, then throw away whatever the owning thread may have overwritten while we were copying. The
+		// slot of event endAfterCopy is the one event endAfterCopy - EVENTS_PER_THREAD lives in, and the owning thread
+		// may be halfway through writing it, so that one goes too
+		uint64_t end = buffer->write_count.load(std::memory_order_acquire);
+		uint64_t begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+		events.clear();
+		for (uint64_t i = begin; i < end; i++)
+		{
+			events.push_back(buffer->events[i & (EVENTS_PER_THREAD - 1)]);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t endAfterCopy = buffer->write_count.load(std::memory_order_relaxed);
+		uint64_t firstValid = endAfterCopy >= EVENTS_PER_THREAD ? endAfterCopy - EVENTS_PER_THREAD + 1 : 0;
+		size_t skip = firstValid > begin ? (size_t)(firstValid - begin) : 0;
+
+		for (size_t i = skip; i < events.size(); i++)
+		{
+			const Event &event = events[i];
+			out << (first ? "" : ",\n") << "{\"name\":";
+			write_json_string(out, event.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_ID
+				<< ",\"ts\":" << event.start / 1000 << "." << (event.start % 1000) / 100
+				<< ",\"dur\":" << event.duration / 1000 << "." << (event.duration % 1000) / 100 << "}";
+			first = false;
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	std::cout << "Wrote CPU trace to " << filePath << std::endl;
+	return true;
+}
+
+// Every thread gets a buffer the first time it records something, one left behind by an exited thread if there is
+// one (its events are dropped then), otherwise a new one
+CpuProfiler::ThreadBuffer* CpuProfiler::get_thread_buffer()
+{
+	thread_local ThreadBufferOwner owner;
+	if (!owner.buffer)
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		for (ThreadBuffer* buffer : thread_buffers)
+		{
+			if (!buffer->in_use)
+			{
+				owner.buffer = buffer;
+				break;
+			}
+		}
+		if (!owner.buffer)
+		{
+			owner.buffer = new ThreadBuffer;
+			thread_buffers.push_back(owner.buffer);
+		}
+
+		owner.buffer->write_count.store(0);
+		owner.buffer->thread_ID = ++num_threads;
+		owner.buffer->thread_name.clear();
+		owner.buffer->in_use = true;
+	}
+	return owner.buffer;
+}
+
+// The events stay in the trace until another thread takes the buffer
+CpuProfiler::ThreadBufferOwner::~ThreadBufferOwner()
+{
+	if (buffer)
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		buffer->in_use = false;
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <chrono>
+
+// Lightweight CPU instrumentation. Scoped zones write one event each into a ring buffer owned by the calling thread,
+// which costs a couple of clock reads and a store, no locks. The most recent events of every thread can be dumped at
+// any time as Chrome trace event JSON (load it in chrome://tracing or https://ui.perfetto.dev)
+class CpuProfiler
+{
+public:
+	static const unsigned int EVENTS_PER_THREAD = 1 << 16;	// must be a power of two
+
+	static void record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);	// name must be a string literal
+	static void setThreadName(const std::string &name);
+	static bool writeChromeTrace(const std::string &filePath);
+
+	static uint64_t now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Scoped zone, records itself when it goes out of scope
+	class Zone
+	{
+	public:
+		Zone(const char* name) : name(name), start(now()) {}
+		~Zone() { record(name, start, now()); }
+	private:
+		const char* name;
+		uint64_t start;
+	};
+
+private:
+	struct Event
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t duration;
+	};
+
+	// Single writer (the owning thread), the dump reads it without stopping the writer and discards anything that
+	// may have been overwritten while it was copying
+	struct ThreadBuffer
+	{
+		std::atomic<uint64_t> write_count;
+		unsigned int thread_ID;
+		std::string thread_name;
+		bool in_use;	// false once the owning thread has exited, the next new thread takes the buffer over
+		Event events[EVENTS_PER_THREAD];
+	};
+
+	// Hands the calling thread's buffer back when the thread exits
+	struct ThreadBufferOwner
+	{
+		ThreadBuffer* buffer;
+		ThreadBufferOwner() : buffer(NULL) {}
+		~ThreadBufferOwner();
+	};
+
+	static std::vector<ThreadBuffer*> thread_buffers;	// guarded by registry_mutex, buffers are reused but never freed
+	static unsigned int num_threads;	// guarded by registry_mutex, gives every thread its own ID even when buffers are reused
+	static std::mutex registry_mutex;
+
+	static ThreadBuffer* get_thread_buffer();
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_ZONE(name) CpuProfiler::Zone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+
+#endif // !CPUPROFILER_H
@@ -0,0 +1,83 @@
+#include "GLExtensions.h"
+
+#include <cstring>
+
+GLEXT_PFNGLGETPROGRAMBINARYPROC GLExtensions::GetProgramBinary = NULL;
+GLEXT_PFNGLPROGRAMBINARYPROC GLExtensions::ProgramBinary = NULL;
+GLEXT_PFNGLPROGRAMPARAMETERIPROC GLExtensions::ProgramParameteri = NULL;
+GLEXT_PFNGLMAXSHADERCOMPILERTHREADSPROC GLExtensions::MaxShaderCompilerThreads = NULL;
+
+bool GLExtensions::program_binary = false;
+bool GLExtensions::parallel_shader_compile = false;
+bool GLExtensions::texture_compression_s3tc = false;
+bool GLExtensions::texture_filter_anisotropic = false;
+
+// Resolves the optional entry points through the same loader glad was initialized with
+void GLExtensions::load(GLADloadproc loader)
+{
+	GetProgramBinary = (GLEXT_PFNGLGETPROGRAMBINARYPROC)loader("glGetProgramBinary");
+	ProgramBinary = (GLEXT_PFNGLPROGRAMBINARYPROC)loader("glProgramBinary");
+	ProgramParameteri = (GLEXT_PFNGLPROGRAMPARAMETERIPROC)loader("glProgramParameteri");
+
+	GLint numBinaryFormats = 0;
+	if (isSupported("GL_ARB_get_program_binary") && GetProgramBinary && ProgramBinary && ProgramParameteri)
+	{
+		glGetIntegerv(GLEXT_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+	}
+	program_binary = numBinaryFormats > 0;
+
+	// The KHR and ARB flavours share enums and differ only in the entry point suffix
+	if (isSupported("GL_KHR_parallel_shader_compile"))
+	{
+		MaxShaderCompilerThreads = (GLEXT_PFNGLMAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsKHR");
+		parallel_shader_compile = true;
+	}
+	else if (isSupported("GL_ARB_parallel_shader_compile"))
+	{
+		MaxShaderCompilerThreads = (GLEXT_PFNGLMAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsARB");
+		parallel_shader_compile = true;
+	}
+
+	// Enums only, compressed uploads go through the core glCompressedTexImage2D
+	texture_compression_s3tc = isSupported("GL_EXT_texture_compression_s3tc");
+	texture_filter_anisotropic = isSupported("GL_EXT_texture_filter_anisotropic") || isSupported("GL_ARB_texture_filter_anisotropic");
+}
+
+bool GLExtensions::isSupported(const char* extensionName)
+{
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint i = 0; i < numExtensions; i++)
+	{
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		if (name && strcmp(name, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// True if the driver can hand out program binaries and accepts at least one binary format
+bool GLExtensions::hasProgramBinary()
+{
+	return program_binary;
+}
+
+
+// True if GLEXT_COMPLETION_STATUS can be queried to find out whether a compile or link finished without blocking
+bool GLExtensions::hasParallelShaderCompile()
+{
+	return parallel_shader_compile;
+}
+
+// True if BC1-BC3 textures can be uploaded, practically every desktop driver has it but it is not core
+bool GLExtensions::hasTextureCompressionS3TC()
+{
+	return texture_compression_s3tc;
+}
+
+bool GLExtensions::hasTextureFilterAnisotropic()
+{
+	return texture_filter_anisotropic;
+}
@@ -0,0 +1,53 @@
+#ifndef GLEXTENSIONS_H
+#define GLEXTENSIONS_H
+
+#include <glad/glad.h>
+
+// glad.c is generated for the GL 3.3 core profile only, optional extension entry points and enums live here instead
+// Call GLExtensions::load once after gladLoadGLLoader, then check the has* functions before using anything below
+
+// GL_ARB_get_program_binary (core in 4.1)
+#define GLEXT_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GLEXT_PROGRAM_BINARY_LENGTH 0x8741
+#define GLEXT_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+#define GLEXT_MAX_SHADER_COMPILER_THREADS 0x91B0
+#define GLEXT_COMPLETION_STATUS 0x91B1
+
+// GL_EXT_texture_compression_s3tc (BC1-BC3, the RGTC formats BC4 and BC5 are core in 3.0)
+#define GLEXT_COMPRESSED_RGB_S3TC_DXT1 0x83F0
+#define GLEXT_COMPRESSED_RGBA_S3TC_DXT1 0x83F1
+#define GLEXT_COMPRESSED_RGBA_S3TC_DXT3 0x83F2
+#define GLEXT_COMPRESSED_RGBA_S3TC_DXT5 0x83F3
+
+// GL_EXT_texture_filter_anisotropic / GL_ARB_texture_filter_anisotropic (core in 4.6)
+#define GLEXT_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GLEXT_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+
+typedef void (APIENTRYP GLEXT_PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP GLEXT_PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP GLEXT_PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP GLEXT_PFNGLMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+class GLExtensions
+{
+public:
+	static void load(GLADloadproc loader);
+	static bool isSupported(const char* extensionName);
+
+	static bool hasProgramBinary();
+	static bool hasParallelShaderCompile();
+	static bool hasTextureCompressionS3TC();
+	static bool hasTextureFilterAnisotropic();
+
+	static GLEXT_PFNGLGETPROGRAMBINARYPROC GetProgramBinary;
+	static GLEXT_PFNGLPROGRAMBINARYPROC ProgramBinary;
+	static GLEXT_PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+	static GLEXT_PFNGLMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads;
+
+private:
+	static bool program_binary, parallel_shader_compile, texture_compression_s3tc, texture_filter_anisotropic;
+};
+
+#endif // !GLEXTENSIONS_H
@@ -0,0 +1,321 @@
+#include "GLStateCache.h"
+
+GLStateCache::GLStateCache()
+{
+	issued_calls = 0;
+	avoided_calls = 0;
+	last_issued_calls = 0;
+	last_avoided_calls = 0;
+	total_avoided_calls = 0;
+	num_frames = 0;
+	invalidate();
+}
+
+GLStateCache::~GLStateCache()
+{
+
+}
+
+void GLStateCache::useProgram(GLuint newProgram)
+{
+	if (changed(program, newProgram))
+	{
+		glUseProgram(newProgram);
+	}
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+	if (changed(vertex_array, vertexArray))
+	{
+		glBindVertexArray(vertexArray);
+		// The element buffer binding is part of the VAO, so switching VAOs switches it too
+		buffers[ELEMENT_ARRAY_BUFFER_TARGET] = UNKNOWN_NAME;
+	}
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+	int index = buffer_target_index(target);
+	if (index < 0)
+	{
+		issued_calls++;
+		glBindBuffer(target, buffer);
+	}
+	else if (changed(buffers[index], buffer))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	int index = texture_target_index(target);
+	if (index >= 0 && unit < MAX_TEXTURE_UNITS && textures[unit][index] == texture)
+	{
+		avoided_calls++;
+		return;
+	}
+
+	if (changed(active_unit, unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	issued_calls++;
+	glBindTexture(target, texture);
+	if (index >= 0 && unit < MAX_TEXTURE_UNITS)
+	{
+		textures[unit][index] = texture;
+	}
+}
+
+// Sampler bindings take the unit directly, the active unit is left alone
+void GLStateCache::bindSampler(GLuint unit, GLuint sampler)
+{
+	if (unit >= MAX_TEXTURE_UNITS)
+	{
+		issued_calls++;
+		glBindSampler(unit, sampler);
+	}
+	else if (changed(samplers[unit], sampler))
+	{
+		glBindSampler(unit, sampler);
+	}
+}
+
+void GLStateCache::setBlend(bool enabled)
+{
+	set_capability(GL_BLEND, blend_enabled, enabled);
+}
+
+void GLStateCache::setBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	if (blend_source == sourceFactor && blend_destination == destinationFactor)
+	{
+		avoided_calls++;
+		return;
+	}
+	issued_calls++;
+	glBlendFunc(sourceFactor, destinationFactor);
+	blend_source = sourceFactor;
+	blend_destination = destinationFactor;
+}
+
+void GLStateCache::setDepthTest(bool enabled)
+{
+	set_capability(GL_DEPTH_TEST, depth_test_enabled, enabled);
+}
+
+void GLStateCache::setDepthMask(bool enabled)
+{
+	if (changed(depth_mask, enabled ? GL_TRUE : GL_FALSE))
+	{
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::setDepthFunc(GLenum func)
+{
+	if (changed(depth_func, func))
+	{
+		glDepthFunc(func);
+	}
+}
+
+void GLStateCache::setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (viewport_known && viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)
+	{
+		avoided_calls++;
+		return;
+	}
+	issued_calls++;
+	glViewport(x, y, width, height);
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+	viewport_known = true;
+}
+
+// Forget everything, the next call of every kind goes through
+void GLStateCache::invalidate()
+{
+	program = UNKNOWN_NAME;
+	vertex_array = UNKNOWN_NAME;
+	invalidateBuffers();
+	invalidateTextures();
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		samplers[unit] = UNKNOWN_NAME;
+	}
+	blend_enabled = UNKNOWN_FLAG;
+	depth_test_enabled = UNKNOWN_FLAG;
+	depth_mask = UNKNOWN_FLAG;
+	blend_source = UNKNOWN_NAME;
+	blend_destination = UNKNOWN_NAME;
+	depth_func = UNKNOWN_NAME;
+	viewport_known = false;
+}
+
+void GLStateCache::invalidateTextures()
+{
+	active_unit = UNKNOWN_NAME;
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		for (int target = 0; target < NUM_TEXTURE_TARGETS; target++)
+		{
+			textures[unit][target] = UNKNOWN_NAME;
+		}
+	}
+}
+
+void GLStateCache::invalidateBuffers()
+{
+	for (int target = 0; target < NUM_BUFFER_TARGETS; target++)
+	{
+		buffers[target] = UNKNOWN_NAME;
+	}
+}
+
+void GLStateCache::forgetProgram(GLuint deletedProgram)
+{
+	if (program == deletedProgram)
+	{
+		program = UNKNOWN_NAME;
+	}
+}
+
+void GLStateCache::forgetVertexArray(GLuint vertexArray)
+{
+	if (vertex_array == vertexArray)
+	{
+		vertex_array = UNKNOWN_NAME;
+		buffers[ELEMENT_ARRAY_BUFFER_TARGET] = UNKNOWN_NAME;
+	}
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer)
+{
+	for (int target = 0; target < NUM_BUFFER_TARGETS; target++)
+	{
+		if (buffers[target] == buffer)
+		{
+			buffers[target] = UNKNOWN_NAME;
+		}
+	}
+}
+
+void GLStateCache::forgetTexture(GLuint texture)
+{
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		for (int target = 0; target < NUM_TEXTURE_TARGETS; target++)
+		{
+			if (textures[unit][target] == texture)
+			{
+				textures[unit][target] = UNKNOWN_NAME;
+			}
+		}
+	}
+}
+
+void GLStateCache::forgetSampler(GLuint sampler)
+{
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		if (samplers[unit] == sampler)
+		{
+			samplers[unit] = UNKNOWN_NAME;
+		}
+	}
+}
+
+void GLStateCache::beginFrame()
+{
+	last_issued_calls = issued_calls;
+	last_avoided_calls = avoided_calls;
+	total_avoided_calls += avoided_calls;
+	num_frames++;
+	issued_calls = 0;
+	avoided_calls = 0;
+}
+
+unsigned int GLStateCache::getNumIssuedCalls() const
+{
+	return last_issued_calls;
+}
+
+unsigned int GLStateCache::getNumAvoidedCalls() const
+{
+	return last_avoided_calls;
+}
+
+double GLStateCache::getAverageAvoidedCalls() const
+{
+	return num_frames > 0 ? (double)total_avoided_calls / num_frames : 0.0;
+}
+
+// Updates the shadow value and counts the call either way, returns true when the call has to be made
+bool GLStateCache::changed(GLuint &current, GLuint value)
+{
+	if (current == value)
+	{
+		avoided_calls++;
+		return false;
+	}
+	issued_calls++;
+	current = value;
+	return true;
+}
+
+bool GLStateCache::changed(GLint &current, GLint value)
+{
+	if (current == value)
+	{
+		avoided_calls++;
+		return false;
+	}
+	issued_calls++;
+	current = value;
+	return true;
+}
+
+void GLStateCache::set_capability(GLenum capability, GLint &current, bool enabled)
+{
+	if (changed(current, enabled ? 1 : 0))
+	{
+		if (enabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+	}
+}
+
+int GLStateCache::buffer_target_index(GLenum target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: return ARRAY_BUFFER_TARGET;
+	case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY_BUFFER_TARGET;
+	case GL_UNIFORM_BUFFER: return UNIFORM_BUFFER_TARGET;
+	case GL_PIXEL_PACK_BUFFER: return PIXEL_PACK_BUFFER_TARGET;
+	case GL_PIXEL_UNPACK_BUFFER: return PIXEL_UNPACK_BUFFER_TARGET;
+	default: return -1;	// not shadowed, always passed through
+	}
+}
+
+int GLStateCache::texture_target_index(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return TEXTURE_2D_TARGET;
+	case GL_TEXTURE_2D_ARRAY: return TEXTURE_2D_ARRAY_TARGET;
+	case GL_TEXTURE_CUBE_MAP: return TEXTURE_CUBE_MAP_TARGET;
+	default: return -1;
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <glad/glad.h>
+
+// Shadows the GL state the renderer changes most and drops calls that would set the value already in place.
+// Everything starts out unknown, so the first call of each kind always reaches the driver. Code that changes the same
+// state without going through the cache (texture uploads, buffer updates) must invalidate the parts it touched
+class GLStateCache
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+	GLStateCache();
+	~GLStateCache();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+	void bindSampler(GLuint unit, GLuint sampler);
+	void setBlend(bool enabled);
+	void setBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+	void setDepthTest(bool enabled);
+	void setDepthMask(bool enabled);
+	void setDepthFunc(GLenum func);
+	void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	void invalidate();
+	void invalidateTextures();
+	void invalidateBuffers();
+
+	// Objects that get deleted while still bound, their names can be handed out again
+	void forgetProgram(GLuint program);
+	void forgetVertexArray(GLuint vertexArray);
+	void forgetBuffer(GLuint buffer);
+	void forgetTexture(GLuint texture);
+	void forgetSampler(GLuint sampler);
+
+	void beginFrame();	// starts a new set of per frame counters
+	unsigned int getNumIssuedCalls() const;		// during the last complete frame
+	unsigned int getNumAvoidedCalls() const;	// during the last complete frame
+	double getAverageAvoidedCalls() const;		// per frame, since creation
+
+private:
+	enum BufferTarget { ARRAY_BUFFER_TARGET, ELEMENT_ARRAY_BUFFER_TARGET, UNIFORM_BUFFER_TARGET, PIXEL_PACK_BUFFER_TARGET, PIXEL_UNPACK_BUFFER_TARGET, NUM_BUFFER_TARGETS };
+	enum TextureTarget { TEXTURE_2D_TARGET, TEXTURE_2D_ARRAY_TARGET, TEXTURE_CUBE_MAP_TARGET, NUM_TEXTURE_TARGETS };
+
+	static const GLuint UNKNOWN_NAME = 0xFFFFFFFF;
+	static const GLint UNKNOWN_FLAG = -1;
+
+	GLuint program, vertex_array;
+	GLuint buffers[NUM_BUFFER_TARGETS];
+	GLuint textures[MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+	GLuint samplers[MAX_TEXTURE_UNITS];
+	GLuint active_unit;
+	GLint blend_enabled, depth_test_enabled, depth_mask;
+	GLenum blend_source, blend_destination, depth_func;
+	GLint viewport[4];
+	bool viewport_known;
+
+	unsigned int issued_calls, avoided_calls;
+	unsigned int last_issued_calls, last_avoided_calls;
+	unsigned long long total_avoided_calls, num_frames;
+
+	bool changed(GLuint &current, GLuint value);
+	bool changed(GLint &current, GLint value);
+	void set_capability(GLenum capability, GLint &current, bool enabled);
+	static int buffer_target_index(GLenum target);
+	static int texture_target_index(GLenum target);
+};
+
+#endif // !GLSTATECACHE_H
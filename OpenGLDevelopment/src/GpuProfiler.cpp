@@ -0,0 +1,226 @@
+#include "GpuProfiler.h"
+
+#include <iomanip>
+
+GpuProfiler::GpuProfiler(unsigned int frameLatency, unsigned int maxZonesPerFrame, unsigned int averageWindow)
+{
+	frame_latency = frameLatency;
+	max_zones = maxZonesPerFrame;
+	average_window = averageWindow;
+	current_frame = 0;
+	num_dropped = 0;
+	in_frame = false;
+
+	frame_average.samples.assign(average_window, 0.0);
+	frame_average.next = 0;
+	frame_average.count = 0;
+	frame_average.sum = 0.0;
+	frame_average.depth = 0;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+
+}
+
+void GpuProfiler::create()
+{
+	frames.resize(frame_latency);
+	for (FrameQueries &frame : frames)
+	{
+		glGenQueries(1, &frame.elapsed_query);
+		frame.timestamp_queries.resize(max_zones * 2);
+		glGenQueries((GLsizei)frame.timestamp_queries.size(), frame.timestamp_queries.data());
+		frame.zones.reserve(max_zones);
+		frame.pending = false;
+	}
+}
+
+void GpuProfiler::clearProfiler()
+{
+	for (FrameQueries &frame : frames)
+	{
+		glDeleteQueries(1, &frame.elapsed_query);
+		glDeleteQueries((GLsizei)frame.timestamp_queries.size(), frame.timestamp_queries.data());
+	}
+	frames.clear();
+}
+
+void GpuProfiler::beginFrame()
+{
+	if (frames.empty())
+	{
+		return;
+	}
+
+	FrameQueries &frame = frames[current_frame % frame_latency];
+
+	// This slot was last used frame_latency frames ago, give its results one last chance before reusing it
+	if (frame.pending)
+	{
+		collect(frame, true);
+	}
+
+	frame.zones.clear();
+	zone_stack.clear();
+	glBeginQuery(GL_TIME_ELAPSED, frame.elapsed_query);
+	in_frame = true;
+}
+
+void GpuProfiler::endFrame()
+{
+	if (!in_frame)
+	{
+		return;
+	}
+
+	while (!zone_stack.empty())
+	{
+		endZone(); // close zones the caller forgot about so their counters are not left dangling
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	frames[current_frame % frame_latency].pending = true;
+	in_frame = false;
+	current_frame++;
+
+	// Pick up every older frame whose results have arrived by now
+	for (FrameQueries &frame : frames)
+	{
+		if (frame.pending)
+		{
+			collect(frame, false);
+		}
+	}
+}
+
+void GpuProfiler::beginZone(const char* name)
+{
+	if (!in_frame)
+	{
+		return;
+	}
+
+	FrameQueries &frame = frames[current_frame % frame_latency];
+	if (frame.zones.size() >= max_zones)
+	{
+		zone_stack.push_back(max_zones); // out of query slots, endZone skips it
+		return;
+	}
+
+	unsigned int index = (unsigned int)frame.zones.size();
+	ZoneRecord zone = { name, (unsigned int)zone_stack.size() };
+	frame.zones.push_back(zone);
+	glQueryCounter(frame.timestamp_queries[index * 2], GL_TIMESTAMP);
+	zone_stack.push_back(index);
+}
+
+void GpuProfiler::endZone()
+{
+	if (!in_frame || zone_stack.empty())
+	{
+		return;
+	}
+
+	unsigned int index = zone_stack.back();
+	zone_stack.pop_back();
+	if (index < max_zones)
+	{
+		glQueryCounter(frames[current_frame % frame_latency].timestamp_queries[index * 2 + 1], GL_TIMESTAMP);
+	}
+}
+
+double GpuProfiler::getAverageMilliseconds(const std::string &zoneName) const
+{
+	auto it = zone_averages.find(zoneName);
+	return it == zone_averages.end() ? 0.0 : average_of(it->second);
+}
+
+double GpuProfiler::getFrameAverageMilliseconds() const
+{
+	return average_of(frame_average);
+}
+
+// Frames whose results were not available in time and were thrown away, a steadily growing count means frameLatency is too low
+unsigned int GpuProfiler::getNumDroppedFrames() const
+{
+	return num_dropped;
+}
+
+void GpuProfiler::printStats(std::ostream &out) const
+{
+	out << "GPU frame: " << std::fixed << std::setprecision(3) << getFrameAverageMilliseconds() << " ms (average of last " << frame_average.count << " frames)" << std::endl;
+	for (const std::string &name : zone_order)
+	{
+		const RollingAverage &average = zone_averages.at(name);
+		out << std::string(2 + average.depth * 2, ' ') << name << ": " << average_of(average) << " ms" << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+}
+
+// Reads the results of a finished frame into the rolling averages. Returns false if they are not available yet,
+// in which case the frame is either left pending or dropped
+bool GpuProfiler::collect(FrameQueries &frame, bool dropIfUnavailable)
+{
+	// The frame query ends after every zone, so it is checked first and the zone counters only once it is in
+	GLint available = 0;
+	glGetQueryObjectiv(frame.elapsed_query, GL_QUERY_RESULT_AVAILABLE, &available);
+	for (size_t i = 0; available && i < frame.zones.size(); i++)
+	{
+		glGetQueryObjectiv(frame.timestamp_queries[i * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	}
+
+	if (!available)
+	{
+		if (dropIfUnavailable)
+		{
+			frame.pending = false;
+			num_dropped++;
+		}
+		return false;
+	}
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(frame.elapsed_query, GL_QUERY_RESULT, &elapsed);
+	add_sample(frame_average, elapsed / 1000000.0);
+
+	for (size_t i = 0; i < frame.zones.size(); i++)
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame.timestamp_queries[i * 2], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.timestamp_queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+		auto it = zone_averages.find(frame.zones[i].name);
+		if (it == zone_averages.end())
+		{
+			RollingAverage average;
+			average.samples.assign(average_window, 0.0);
+			average.next = 0;
+			average.count = 0;
+			average.sum = 0.0;
+			average.depth = frame.zones[i].depth;
+			it = zone_averages.emplace(frame.zones[i].name, average).first;
+			zone_order.push_back(frame.zones[i].name);
+		}
+		add_sample(it->second, end > begin ? (end - begin) / 1000000.0 : 0.0);
+	}
+
+	frame.pending = false;
+	return true;
+}
+
+void GpuProfiler::add_sample(RollingAverage &average, double milliseconds)
+{
+	average.sum += milliseconds - average.samples[average.next];
+	average.samples[average.next] = milliseconds;
+	average.next = (average.next + 1) % average.samples.size();
+	if (average.count < average.samples.size())
+	{
+		average.count++;
+	}
+}
+
+double GpuProfiler::average_of(const RollingAverage &average)
+{
+	return average.count > 0 ? average.sum / average.count : 0.0;
+}
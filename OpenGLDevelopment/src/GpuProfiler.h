@@ -0,0 +1,86 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// Measures GPU time per frame (GL_TIME_ELAPSED) and per named zone (a pair of GL_TIMESTAMP counters, so zones can nest)
+// Query sets are recycled through a ring several frames deep and results are only read once the GPU reports them
+// available, so profiling never stalls the pipeline. A frame whose results are still not in when its slot comes round
+// again is dropped instead of waited on
+class GpuProfiler
+{
+public:
+	GpuProfiler(unsigned int frameLatency = 4, unsigned int maxZonesPerFrame = 64, unsigned int averageWindow = 60);
+	~GpuProfiler();
+
+	void create();
+	void clearProfiler();
+
+	void beginFrame();
+	void endFrame();
+	void beginZone(const char* name);	// name must outlive the frame (string literals)
+	void endZone();
+
+	double getAverageMilliseconds(const std::string &zoneName) const;	// rolling average, 0 if the zone has no results yet
+	double getFrameAverageMilliseconds() const;
+	unsigned int getNumDroppedFrames() const;
+	void printStats(std::ostream &out) const;
+
+	// Scoped zone, ends when it goes out of scope
+	class Zone
+	{
+	public:
+		Zone(GpuProfiler &profiler, const char* name) : profiler(profiler) { profiler.beginZone(name); }
+		~Zone() { profiler.endZone(); }
+	private:
+		GpuProfiler &profiler;
+	};
+
+private:
+	struct ZoneRecord
+	{
+		const char* name;
+		unsigned int depth;
+	};
+
+	struct FrameQueries
+	{
+		GLuint elapsed_query;
+		std::vector<GLuint> timestamp_queries;	// begin and end counter for every zone slot
+		std::vector<ZoneRecord> zones;
+		bool pending;
+	};
+
+	struct RollingAverage
+	{
+		std::vector<double> samples;
+		unsigned int next, count;
+		double sum;
+		unsigned int depth;
+	};
+
+	unsigned int frame_latency, max_zones, average_window;
+	std::vector<FrameQueries> frames;
+	unsigned int current_frame, num_dropped;
+	std::vector<unsigned int> zone_stack;
+	bool in_frame;
+
+	RollingAverage frame_average;
+	std::unordered_map<std::string, RollingAverage> zone_averages;
+	std::vector<std::string> zone_order;	// first seen order, for printing
+
+	bool collect(FrameQueries &frame, bool dropIfUnavailable);
+	void add_sample(RollingAverage &average, double milliseconds);
+	static double average_of(const RollingAverage &average);
+};
+
+#define GPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define GPU_PROFILE_CONCAT(a, b) GPU_PROFILE_CONCAT_INNER(a, b)
+#define GPU_PROFILE_ZONE(profiler, name) GpuProfiler::Zone GPU_PROFILE_CONCAT(gpuProfileZone, __LINE__)(profiler, name)
+
+#endif // !GPUPROFILER_H
@@ -0,0 +1,108 @@
+#include "HeadlessContext.h"
+
+HeadlessContext::HeadlessContext()
+{
+#ifdef HEADLESS_EGL_AVAILABLE
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+#endif
+	created = false;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+
+}
+
+// Creates the context and makes it current with no surface at all, rendering has to go into a framebuffer object
+bool HeadlessContext::create()
+{
+#ifdef HEADLESS_EGL_AVAILABLE
+	// Prefer Mesa's surfaceless platform, it needs neither a display server nor a GPU
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+	{
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0, minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "Failed to initialize an EGL display" << std::endl;
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "EGL display does not support desktop OpenGL" << std::endl;
+		eglTerminate(display);
+		display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	eglChooseConfig(display, configAttributes, &config, 1, &numConfigs);
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "Failed to create a surfaceless EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		clearContext();
+		return false;
+	}
+
+	std::cout << "Created headless EGL " << major << "." << minor << " context" << std::endl;
+	created = true;
+	return true;
+#else
+	std::cout << "Headless EGL contexts are not available on this platform" << std::endl;
+	return false;
+#endif
+}
+
+void HeadlessContext::clearContext()
+{
+#ifdef HEADLESS_EGL_AVAILABLE
+	if (display != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context != EGL_NO_CONTEXT)
+		{
+			eglDestroyContext(display, context);
+		}
+		eglTerminate(display);
+	}
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+#endif
+	created = false;
+}
+
+bool HeadlessContext::isCreated() const
+{
+	return created;
+}
+
+void* HeadlessContext::getProcAddress(const char* name)
+{
+#ifdef HEADLESS_EGL_AVAILABLE
+	return (void*)eglGetProcAddress(name);
+#else
+	return NULL;
+#endif
+}
@@ -0,0 +1,34 @@
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+#include <iostream>
+
+// EGL surfaceless GL 3.3 core context for rendering without a window (batch jobs, CI on GPU-less boxes with Mesa llvmpipe)
+// Only available where EGL is (HEADLESS_EGL_AVAILABLE), elsewhere create() fails and the caller falls back to a hidden window
+#if defined(__linux__)
+#define HEADLESS_EGL_AVAILABLE 1
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	bool create();
+	void clearContext();
+	bool isCreated() const;
+
+	static void* getProcAddress(const char* name);	// pass to gladLoadGLLoader once the context is current
+
+private:
+#ifdef HEADLESS_EGL_AVAILABLE
+	EGLDisplay display;
+	EGLContext context;
+#endif
+	bool created;
+};
+
+#endif // !HEADLESSCONTEXT_H
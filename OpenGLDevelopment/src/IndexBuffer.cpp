@@ -0,0 +1,75 @@
+#include "IndexBuffer.h"
+
+#include <vector>
+
+IndexBuffer::IndexBuffer()
+{
+	buffer_ID = 0;
+	index_type = GL_UNSIGNED_INT;
+	index_count = 0;
+}
+
+IndexBuffer::~IndexBuffer()
+{
+
+}
+
+void IndexBuffer::create(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	index_count = (GLsizei)indexCount;
+	index_type = vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	if (buffer_ID == 0)
+	{
+		glGenBuffers(1, &buffer_ID);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer_ID);
+
+	if (index_type == GL_UNSIGNED_SHORT)
+	{
+		std::vector<uint16_t> shortIndices(indices, indices + indexCount);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+	}
+}
+
+void IndexBuffer::bind() const
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer_ID);
+}
+
+void IndexBuffer::clearBuffer()
+{
+	if (buffer_ID == 0)
+	{
+		std::cout << "Error in IndexBuffer::clearBuffer --> buffer_ID == " << buffer_ID << ", (tried to clear unallocated buffer)" << std::endl;
+		return;
+	}
+
+	glDeleteBuffers(1, &buffer_ID);
+	buffer_ID = 0;
+	index_count = 0;
+}
+
+GLuint IndexBuffer::getID() const
+{
+	return buffer_ID;
+}
+
+GLenum IndexBuffer::getType() const
+{
+	return index_type;
+}
+
+GLsizei IndexBuffer::getCount() const
+{
+	return index_count;
+}
+
+size_t IndexBuffer::getIndexSize() const
+{
+	return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
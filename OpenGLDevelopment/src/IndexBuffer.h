@@ -0,0 +1,33 @@
+#ifndef INDEXBUFFER_H
+#define INDEXBUFFER_H
+
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Element buffer that stores indices as GL_UNSIGNED_SHORT whenever every vertex can be addressed with 16 bits,
+// halving the index data for all but the biggest meshes. Indices are handed in as 32 bit either way
+class IndexBuffer
+{
+public:
+	IndexBuffer();
+	~IndexBuffer();
+
+	void create(const uint32_t* indices, size_t indexCount, size_t vertexCount);	// the VAO to attach it to must be bound
+	void bind() const;	// attaches the buffer to the bound VAO
+	void clearBuffer();
+
+	GLuint getID() const;
+	GLenum getType() const;
+	GLsizei getCount() const;
+	size_t getIndexSize() const;
+
+private:
+	GLuint buffer_ID;
+	GLenum index_type;
+	GLsizei index_count;
+};
+
+#endif // !INDEXBUFFER_H
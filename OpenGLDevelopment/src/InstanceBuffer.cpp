@@ -0,0 +1,89 @@
+#include "InstanceBuffer.h"
+
+#include <cstddef>
+
+InstanceBuffer::InstanceBuffer()
+{
+	buffer_ID = 0;
+	capacity = 0;
+	num_instances = 0;
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+
+}
+
+void InstanceBuffer::create(GLuint vertexArray, GLuint firstAttribute, unsigned int initialCapacity)
+{
+	capacity = initialCapacity;
+	num_instances = 0;
+
+	glGenBuffers(1, &buffer_ID);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer_ID);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+
+	// offset.xy, scale, rotation
+	glVertexAttribPointer(firstAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, offset));
+	glEnableVertexAttribArray(firstAttribute);
+	glVertexAttribDivisor(firstAttribute, 1);
+
+	// color
+	glVertexAttribPointer(firstAttribute + 1, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+	glEnableVertexAttribArray(firstAttribute + 1);
+	glVertexAttribDivisor(firstAttribute + 1, 1);
+
+	// texture array layer, an integer attribute so it reaches the shader unconverted
+	glVertexAttribIPointer(firstAttribute + 2, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)offsetof(InstanceData, layer));
+	glEnableVertexAttribArray(firstAttribute + 2);
+	glVertexAttribDivisor(firstAttribute + 2, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Replaces the instance data. The old storage is orphaned rather than overwritten, so a draw still reading it
+// never makes us wait
+void InstanceBuffer::update(const InstanceData* instances, unsigned int count)
+{
+	if (buffer_ID == 0)
+	{
+		std::cout << "Error in InstanceBuffer::update --> buffer_ID == " << buffer_ID << ", (buffer was not created)" << std::endl;
+		return;
+	}
+
+	if (count > capacity)
+	{
+		capacity = count;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, buffer_ID);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	num_instances = count;
+}
+
+void InstanceBuffer::clearBuffer()
+{
+	if (buffer_ID == 0)
+	{
+		std::cout << "Error in InstanceBuffer::clearBuffer --> buffer_ID == " << buffer_ID << ", (tried to clear unallocated buffer)" << std::endl;
+		return;
+	}
+
+	glDeleteBuffers(1, &buffer_ID);
+	buffer_ID = 0;
+	capacity = 0;
+	num_instances = 0;
+}
+
+GLuint InstanceBuffer::getID() const
+{
+	return buffer_ID;
+}
+
+unsigned int InstanceBuffer::getNumInstances() const
+{
+	return num_instances;
+}
@@ -0,0 +1,39 @@
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+#include <iostream>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Per instance attributes, two vec4s and a uint in the vertex shader (see shaders/instanced.vert)
+struct InstanceData
+{
+	float offset[2];
+	float scale;
+	float rotation;	// radians
+	float color[4];
+	uint32_t layer;	// TextureArray layer
+};
+
+// Second vertex buffer attached to a mesh's VAO with a divisor of 1, so every instance of an instanced draw reads the
+// next InstanceData. Lets one glDrawElementsInstanced call stand in for a uniform update plus a draw per object
+class InstanceBuffer
+{
+public:
+	InstanceBuffer();
+	~InstanceBuffer();
+
+	void create(GLuint vertexArray, GLuint firstAttribute, unsigned int capacity);	// uses attributes firstAttribute to firstAttribute + 2
+	void update(const InstanceData* instances, unsigned int count);
+	void clearBuffer();
+
+	GLuint getID() const;
+	unsigned int getNumInstances() const;
+
+private:
+	GLuint buffer_ID;
+	unsigned int capacity, num_instances;
+};
+
+#endif // !INSTANCEBUFFER_H
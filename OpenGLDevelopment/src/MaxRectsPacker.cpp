@@ -0,0 +1,134 @@
+#include "MaxRectsPacker.h"
+
+#include <climits>
+#include <algorithm>
+
+MaxRectsPacker::MaxRectsPacker(int width, int height)
+{
+	bin_width = width;
+	bin_height = height;
+	used_area = 0;
+
+	PackedRect all = { 0, 0, width, height };
+	free_rects.push_back(all);
+}
+
+MaxRectsPacker::~MaxRectsPacker()
+{
+
+}
+
+bool MaxRectsPacker::insert(int width, int height, PackedRect &placed)
+{
+	if (!find_position(width, height, placed))
+	{
+		return false;
+	}
+
+	split_free_rects(placed);
+	prune_free_rects();
+	used_area += (long long)width * height;
+	return true;
+}
+
+float MaxRectsPacker::getOccupancy() const
+{
+	return (float)((double)used_area / ((double)bin_width * bin_height));
+}
+
+bool MaxRectsPacker::find_position(int width, int height, PackedRect &best) const
+{
+	int bestShortSide = INT_MAX, bestLongSide = INT_MAX;
+	for (const PackedRect &free : free_rects)
+	{
+		if (free.width < width || free.height < height)
+		{
+			continue;
+		}
+
+		int leftoverX = free.width - width, leftoverY = free.height - height;
+		int shortSide = std::min(leftoverX, leftoverY), longSide = std::max(leftoverX, leftoverY);
+		if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+		{
+			best.x = free.x;
+			best.y = free.y;
+			best.width = width;
+			best.height = height;
+			bestShortSide = shortSide;
+			bestLongSide = longSide;
+		}
+	}
+	return bestShortSide != INT_MAX;
+}
+
+// Every free rectangle the new one overlaps is replaced by the (up to four) maximal pieces left around it
+void MaxRectsPacker::split_free_rects(const PackedRect &placed)
+{
+	std::vector<PackedRect> pieces;
+	for (size_t i = 0; i < free_rects.size();)
+	{
+		PackedRect free = free_rects[i];
+		if (placed.x >= free.x + free.width || placed.x + placed.width <= free.x ||
+			placed.y >= free.y + free.height || placed.y + placed.height <= free.y)
+		{
+			i++;
+			continue;
+		}
+
+		if (placed.x > free.x)
+		{
+			PackedRect left = { free.x, free.y, placed.x - free.x, free.height };
+			pieces.push_back(left);
+		}
+		if (placed.x + placed.width < free.x + free.width)
+		{
+			PackedRect right = { placed.x + placed.width, free.y, free.x + free.width - (placed.x + placed.width), free.height };
+			pieces.push_back(right);
+		}
+		if (placed.y > free.y)
+		{
+			PackedRect top = { free.x, free.y, free.width, placed.y - free.y };
+			pieces.push_back(top);
+		}
+		if (placed.y + placed.height < free.y + free.height)
+		{
+			PackedRect bottom = { free.x, placed.y + placed.height, free.width, free.y + free.height - (placed.y + placed.height) };
+			pieces.push_back(bottom);
+		}
+
+		free_rects[i] = free_rects.back();
+		free_rects.pop_back();
+	}
+	free_rects.insert(free_rects.end(), pieces.begin(), pieces.end());
+}
+
+// Drops free rectangles that lie completely inside another one
+void MaxRectsPacker::prune_free_rects()
+{
+	for (size_t i = 0; i < free_rects.size(); i++)
+	{
+		for (size_t j = i + 1; j < free_rects.size();)
+		{
+			if (contains(free_rects[j], free_rects[i]))
+			{
+				free_rects[i] = free_rects.back();
+				free_rects.pop_back();
+				i--;
+				break;
+			}
+			if (contains(free_rects[i], free_rects[j]))
+			{
+				free_rects[j] = free_rects.back();
+				free_rects.pop_back();
+				continue;
+			}
+			j++;
+		}
+	}
+}
+
+bool MaxRectsPacker::contains(const PackedRect &outer, const PackedRect &inner)
+{
+	return inner.x >= outer.x && inner.y >= outer.y &&
+		inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+}
@@ -0,0 +1,34 @@
+#ifndef MAXRECTSPACKER_H
+#define MAXRECTSPACKER_H
+
+#include <vector>
+
+struct PackedRect
+{
+	int x, y, width, height;
+};
+
+// Packs rectangles into a fixed size bin with the MaxRects algorithm (Jukka Jylanki, "A Thousand Ways to Pack the
+// Bin"). The free space is kept as a list of maximal, possibly overlapping rectangles, and every new rectangle goes
+// where it leaves the shortest leftover side (best short side fit)
+class MaxRectsPacker
+{
+public:
+	MaxRectsPacker(int width, int height);
+	~MaxRectsPacker();
+
+	bool insert(int width, int height, PackedRect &placed);	// false when it does not fit anywhere
+	float getOccupancy() const;	// used area / bin area
+
+private:
+	int bin_width, bin_height;
+	long long used_area;
+	std::vector<PackedRect> free_rects;
+
+	bool find_position(int width, int height, PackedRect &best) const;
+	void split_free_rects(const PackedRect &placed);
+	void prune_free_rects();
+	static bool contains(const PackedRect &outer, const PackedRect &inner);
+};
+
+#endif // !MAXRECTSPACKER_H
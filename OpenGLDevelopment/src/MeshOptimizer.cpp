@@ -0,0 +1,232 @@
+#include "MeshOptimizer.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Scoring constants from Forsyth's paper, the simulated LRU cache is bigger than any real FIFO so the scores
+	// still favour recently used vertices when the hardware cache is smaller
+	const int SCORE_CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	float vertex_score(int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return -1.0f;	// nothing left to draw with this vertex
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// Used by the last triangle, a fixed score so the next triangle does not just reuse the same edge
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				const float scale = 1.0f / (SCORE_CACHE_SIZE - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+			}
+		}
+
+		// Vertices with few triangles left get a boost, so they are finished off instead of left stranded
+		score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+		return score;
+	}
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangle lists per vertex, packed into one array. remaining[v] is the number of not yet emitted triangles,
+	// they are kept at the front of the vertex's range
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = vertex_score(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* triangle = indices + t * 3;
+		triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+		if (triangleScores[t] > bestScore)
+		{
+			bestScore = triangleScores[t];
+			bestTriangle = (int)t;
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	uint32_t cache[SCORE_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	size_t scanCursor = 0;
+
+	while (output.size() < triangleCount * 3)
+	{
+		// Nothing in the cache has triangles left, carry on with the first triangle that has not been drawn yet
+		if (bestTriangle < 0)
+		{
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = (int)scanCursor;
+		}
+
+		const uint32_t* triangle = indices + bestTriangle * 3;
+		emitted[bestTriangle] = true;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = triangle[corner];
+			output.push_back(v);
+
+			// Swap the triangle out of the live part of the vertex's list
+			unsigned int* list = adjacency.data() + offsets[v];
+			for (unsigned int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == (unsigned int)bestTriangle)
+				{
+					list[i] = list[remaining[v] - 1];
+					list[remaining[v] - 1] = (unsigned int)bestTriangle;
+					remaining[v]--;
+					break;
+				}
+			}
+		}
+
+		// The triangle's vertices move to the front of the LRU cache, everything else shifts back
+		uint32_t newCache[SCORE_CACHE_SIZE + 3];
+		int newCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = triangle[corner];
+			if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+			{
+				newCache[newCount++] = v;
+			}
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache[newCount++] = v;
+			}
+		}
+
+		// Rescore every vertex whose position changed (including the ones that just fell out) and their triangles
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < SCORE_CACHE_SIZE ? i : -1;
+			vertexScores[v] = vertex_score(cachePosition[v], remaining[v]);
+		}
+		for (int i = 0; i < newCount; i++)
+		{
+			uint32_t v = newCache[i];
+			const unsigned int* list = adjacency.data() + offsets[v];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = list[j];
+				const uint32_t* other = indices + t * 3;
+				triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+
+		cacheCount = newCount < SCORE_CACHE_SIZE ? newCount : SCORE_CACHE_SIZE;
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, uint32_t* indices, size_t indexCount)
+{
+	const uint32_t UNUSED = 0xFFFFFFFF;
+	std::vector<uint32_t> remap(vertexCount, UNUSED);
+	std::vector<unsigned char> reordered(vertexCount * vertexSize);
+	const unsigned char* source = (const unsigned char*)vertices;
+
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t v = indices[i];
+		if (remap[v] == UNUSED)
+		{
+			remap[v] = nextVertex;
+			memcpy(reordered.data() + nextVertex * vertexSize, source + v * vertexSize, vertexSize);
+			nextVertex++;
+		}
+		indices[i] = remap[v];
+	}
+
+	memcpy(vertices, reordered.data(), nextVertex * vertexSize);
+	return nextVertex;
+}
+
+float MeshOptimizer::computeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return 0.0f;
+	}
+
+	// FIFO, like the hardware: a hit does not move the vertex, a miss pushes out the oldest entry
+	std::vector<size_t> insertedAt(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		uint32_t v = indices[i];
+		if (insertedAt[v] == 0 || misses + 1 - insertedAt[v] > cacheSize)
+		{
+			misses++;
+			insertedAt[v] = misses;
+		}
+	}
+	return (float)misses / triangleCount;
+}
@@ -0,0 +1,25 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Load time passes over indexed triangle lists, run them before the mesh is uploaded
+namespace MeshOptimizer
+{
+	const unsigned int DEFAULT_CACHE_SIZE = 16;	// FIFO size used to estimate the post transform cache
+
+	// Reorders triangles so vertices are reused while they are still in the post transform cache (Tom Forsyth's
+	// "Linear-Speed Vertex Cache Optimisation"). Only the triangle order changes, the mesh looks the same
+	void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	// Renumbers vertices in the order the index buffer first uses them and reorders the vertex data to match, so
+	// vertex fetch walks memory mostly forwards. Unused vertices are dropped, returns the new vertex count
+	size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, uint32_t* indices, size_t indexCount);
+
+	// Average cache miss ratio, vertex shader invocations per triangle with a FIFO cache of cacheSize entries.
+	// 3.0 is the worst possible, 0.5 is about the best a regular grid can do
+	float computeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE);
+}
+
+#endif // !MESHOPTIMIZER_H
@@ -0,0 +1,290 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <algorithm>
+
+#ifdef MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "CpuProfiler.h"
+
+namespace
+{
+	const int MIN_PIXELS_TO_SPLIT = 128 * 128;	// smaller levels are done in one go, the hand-off would cost more than it saves
+	const int MIN_ROWS_PER_JOB = 16;
+	const int ENCODE_TABLE_SIZE = 8192;	// fine enough that the first guess is at most one step low
+
+	float srgb_to_linear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	struct SrgbTables
+	{
+		float to_linear[256];
+		float threshold[257];	// smallest linear value that encodes to each byte, threshold[256] ends the step past 255
+		unsigned char from_linear[ENCODE_TABLE_SIZE];	// first guess, corrected with threshold
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				to_linear[i] = srgb_to_linear(i / 255.0f);
+				threshold[i] = i == 0 ? 0.0f : srgb_to_linear((i - 0.5f) / 255.0f);
+			}
+			threshold[256] = 2.0f;
+
+			// Each entry is the answer for a value half an entry below its range, so float error in the index can not
+			// make the guess too high. An entry and a half is still narrower than the closest two thresholds
+			int value = 0;
+			for (int i = 0; i < ENCODE_TABLE_SIZE; i++)
+			{
+				const float low = (i - 0.5f) / (ENCODE_TABLE_SIZE - 1);
+				while (value < 255 && low >= threshold[value + 1])
+				{
+					value++;
+				}
+				from_linear[i] = (unsigned char)value;
+			}
+		}
+
+		// Exact round to nearest, the table gives the answer or the one below it and the next threshold settles it
+		unsigned char encode(float linear) const
+		{
+			linear = std::min(std::max(linear, 0.0f), 1.0f);
+			int value = from_linear[(int)(linear * (ENCODE_TABLE_SIZE - 1))];
+			if (linear >= threshold[value + 1])
+			{
+				value++;
+			}
+			return (unsigned char)value;
+		}
+	};
+
+	const SrgbTables& srgb_tables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	// Averages each 2x2 block of row0/row1 into one output pixel. Odd source sizes drop the last column like the GL
+	// mip size rule does, a source that is a single pixel wide uses that pixel twice
+	void downsample_row(const unsigned char* row0, const unsigned char* row1, unsigned char* output, int sourceWidth, int outputWidth, int numChannels)
+	{
+		int x = 0;
+#ifdef MIP_GENERATOR_SSE2
+		if (numChannels == 4)
+		{
+			// 4 source pixels from each row make 2 output pixels
+			const __m128i zero = _mm_setzero_si128(), rounding = _mm_set1_epi16(2);
+			for (; x + 2 <= outputWidth; x += 2)
+			{
+				__m128i top = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+				__m128i bottom = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));		// pixels 0 and 1
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));	// pixels 2 and 3
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+				__m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+				_mm_storel_epi64((__m128i*)(output + x * 4), _mm_packus_epi16(average, average));
+			}
+		}
+#endif
+		for (; x < outputWidth; x++)
+		{
+			const int left = x * 2 * numChannels, right = std::min(x * 2 + 1, sourceWidth - 1) * numChannels;
+			for (int c = 0; c < numChannels; c++)
+			{
+				int sum = row0[left + c] + row0[right + c] + row1[left + c] + row1[right + c];
+				output[x * numChannels + c] = (unsigned char)((sum + 2) >> 2);
+			}
+		}
+	}
+
+	// Same as downsample_row, but the colour channels are averaged in linear light. The last channel of grey + alpha
+	// and RGBA images is alpha and is averaged as is. Scalar for every channel count: each colour value is four decode
+	// and two encode table reads, SSE2 has no gather to do those with, and packing scalar loads into vectors measured
+	// slower than this loop
+	void downsample_row_srgb(const unsigned char* row0, const unsigned char* row1, unsigned char* output, int sourceWidth, int outputWidth, int numChannels)
+	{
+		const SrgbTables &tables = srgb_tables();
+		const int colorChannels = (numChannels == 2 || numChannels == 4) ? numChannels - 1 : numChannels;
+
+		for (int x = 0; x < outputWidth; x++)
+		{
+			const int left = x * 2 * numChannels, right = std::min(x * 2 + 1, sourceWidth - 1) * numChannels;
+			for (int c = 0; c < numChannels; c++)
+			{
+				if (c < colorChannels)
+				{
+					float sum = tables.to_linear[row0[left + c]] + tables.to_linear[row0[right + c]] +
+						tables.to_linear[row1[left + c]] + tables.to_linear[row1[right + c]];
+					output[x * numChannels + c] = tables.encode(sum * 0.25f);
+				}
+				else
+				{
+					int sum = row0[left + c] + row0[right + c] + row1[left + c] + row1[right + c];
+					output[x * numChannels + c] = (unsigned char)((sum + 2) >> 2);
+				}
+			}
+		}
+	}
+}
+
+MipGenerator::MipGenerator(unsigned int numThreads) : stopping(false)
+{
+	if (numThreads == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		workers.emplace_back(&MipGenerator::worker_loop, this);
+	}
+}
+
+MipGenerator::~MipGenerator()
+{
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		stopping = true;
+	}
+	job_available.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void MipGenerator::generate(const unsigned char* pixels, int width, int height, int numChannels, bool srgb, std::vector<MipLevel> &levels)
+{
+	CPU_PROFILE_ZONE("Generate mips");
+	levels.resize(countLevels(width, height) - 1);
+
+	const unsigned char* source = pixels;
+	int sourceWidth = width, sourceHeight = height;
+	for (MipLevel &level : levels)
+	{
+		level.width = std::max(sourceWidth / 2, 1);
+		level.height = std::max(sourceHeight / 2, 1);
+		level.pixels.resize((size_t)level.width * level.height * numChannels);
+
+		Job job = { source, sourceWidth, sourceHeight, &level, numChannels, srgb, 0, level.height, NULL };
+
+		int numBands = 1;
+		if (level.width * level.height >= MIN_PIXELS_TO_SPLIT)
+		{
+			numBands = std::max(std::min((int)workers.size() + 1, level.height / MIN_ROWS_PER_JOB), 1);
+		}
+
+		if (numBands == 1)
+		{
+			run_job(job);
+		}
+		else
+		{
+			// Each level needs the whole level above it, so the bands of one level all finish before the next starts
+			unsigned int remaining = numBands;
+			job.remaining = &remaining;
+			{
+				std::lock_guard<std::mutex> lock(job_mutex);
+				for (int band = 0; band < numBands; band++)
+				{
+					job.first_row = level.height * band / numBands;
+					job.end_row = level.height * (band + 1) / numBands;
+					job_queue.push_back(job);
+				}
+			}
+			job_available.notify_all();
+
+			// Work on queued bands (ours or another caller's) rather than sleeping
+			std::unique_lock<std::mutex> lock(job_mutex);
+			while (remaining > 0)
+			{
+				if (job_queue.empty())
+				{
+					job_finished.wait(lock);
+					continue;
+				}
+
+				Job next = job_queue.front();
+				job_queue.pop_front();
+				lock.unlock();
+				run_job(next);
+				lock.lock();
+				finish_job(next);
+			}
+		}
+
+		source = level.pixels.data();
+		sourceWidth = level.width;
+		sourceHeight = level.height;
+	}
+}
+
+int MipGenerator::countLevels(int width, int height)
+{
+	int levels = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+	{
+		levels++;
+	}
+	return levels;
+}
+
+void MipGenerator::worker_loop()
+{
+	CpuProfiler::setThreadName("Mip generator");
+	std::unique_lock<std::mutex> lock(job_mutex);
+	while (true)
+	{
+		job_available.wait(lock, [this] { return stopping || !job_queue.empty(); });
+		if (stopping)
+		{
+			return;
+		}
+
+		Job job = job_queue.front();
+		job_queue.pop_front();
+		lock.unlock();
+		{
+			CPU_PROFILE_ZONE("Downsample mip band");
+			run_job(job);
+		}
+		lock.lock();
+		finish_job(job);
+	}
+}
+
+// Called with job_mutex held
+void MipGenerator::finish_job(const Job &job)
+{
+	if (--*job.remaining == 0)
+	{
+		job_finished.notify_all();
+	}
+}
+
+void MipGenerator::run_job(const Job &job)
+{
+	const size_t sourceStride = (size_t)job.source_width * job.num_channels;
+	const size_t outputStride = (size_t)job.destination->width * job.num_channels;
+	for (int y = job.first_row; y < job.end_row; y++)
+	{
+		const unsigned char* row0 = job.source + (size_t)(y * 2) * sourceStride;
+		const unsigned char* row1 = job.source + (size_t)std::min(y * 2 + 1, job.source_height - 1) * sourceStride;
+		unsigned char* output = job.destination->pixels.data() + (size_t)y * outputStride;
+
+		if (job.srgb)
+		{
+			downsample_row_srgb(row0, row1, output, job.source_width, job.destination->width, job.num_channels);
+		}
+		else
+		{
+			downsample_row(row0, row1, output, job.source_width, job.destination->width, job.num_channels);
+		}
+	}
+}
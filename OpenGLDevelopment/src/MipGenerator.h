@@ -0,0 +1,60 @@
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define MIP_GENERATOR_SSE2
+#endif
+
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> pixels;	// tightly packed, same channel count as the base level
+};
+
+// Builds mip chains on the CPU so uploads do not depend on glGenerateMipmap (whose filter quality and cost vary between
+// drivers, and which runs on the GL thread). Every level is a 2x2 box filter of the one above it, computed in bands of
+// rows on a pool of worker threads. Only linear RGBA levels have an SSE2 kernel, everything else is scalar.
+// Colour channels of sRGB images are converted to linear light before averaging and back afterwards, otherwise the
+// smaller levels come out too dark. Alpha is always treated as linear
+class MipGenerator
+{
+public:
+	MipGenerator(unsigned int numThreads = 0);	// 0 picks one worker per hardware thread, leaving one for the caller
+	~MipGenerator();
+
+	// Fills levels with every level below the base one, down to 1x1. Safe to call from several threads at once,
+	// the calling thread works on its own bands while it waits
+	void generate(const unsigned char* pixels, int width, int height, int numChannels, bool srgb, std::vector<MipLevel> &levels);
+
+	static int countLevels(int width, int height);	// including the base level
+
+private:
+	struct Job
+	{
+		const unsigned char* source;
+		int source_width, source_height;
+		MipLevel* destination;
+		int num_channels;
+		bool srgb;
+		int first_row, end_row;
+		unsigned int* remaining;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<Job> job_queue;
+	std::mutex job_mutex;
+	std::condition_variable job_available, job_finished;
+	bool stopping;
+
+	void worker_loop();
+	void finish_job(const Job &job);
+	static void run_job(const Job &job);
+};
+
+#endif // !MIPGENERATOR_H
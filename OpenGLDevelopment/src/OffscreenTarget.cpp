@@ -0,0 +1,205 @@
+#include "OffscreenTarget.h"
+
+#include <cstdio>
+#include <fstream>
+
+OffscreenTarget::OffscreenTarget()
+{
+	framebuffer_ID = 0;
+	color_buffer = 0;
+	depth_buffer = 0;
+	width = 0;
+	height = 0;
+	raw_output = false;
+	next_slot = 0;
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+
+}
+
+bool OffscreenTarget::create(int width, int height, const std::string &outputPrefix, bool rawOutput, unsigned int numReadbackSlots)
+{
+	this->width = width;
+	this->height = height;
+	output_prefix = outputPrefix;
+	raw_output = rawOutput;
+
+	glGenFramebuffers(1, &framebuffer_ID);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_ID);
+
+	glGenRenderbuffers(1, &color_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+
+	glGenRenderbuffers(1, &depth_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Error creating offscreen framebuffer, status 0x" << std::hex << status << std::dec << std::endl;
+		return false;
+	}
+
+	slots.resize(numReadbackSlots);
+	for (ReadbackSlot &slot : slots)
+	{
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+		slot.fence = 0;
+		slot.frame_number = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	next_slot = 0;
+	return true;
+}
+
+void OffscreenTarget::bind(GLStateCache &state) const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_ID);
+	state.setViewport(0, 0, width, height);
+}
+
+void OffscreenTarget::readback(unsigned int frameNumber)
+{
+	ReadbackSlot &slot = slots[next_slot];
+	next_slot = (next_slot + 1) % slots.size();
+
+	// Every slot is still in flight, the oldest one has to be written out before it can be reused
+	if (slot.fence)
+	{
+		glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		write_slot(slot);
+	}
+
+	// With a pixel pack buffer bound glReadPixels only queues the copy, the pointer is an offset into the buffer
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_ID);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame_number = frameNumber;
+}
+
+unsigned int OffscreenTarget::collect(bool waitForAll)
+{
+	unsigned int numWritten = 0;
+
+	// Walk the slots oldest first so frames are written in order
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		ReadbackSlot &slot = slots[(next_slot + i) % slots.size()];
+		if (!slot.fence)
+		{
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, waitForAll ? GL_TIMEOUT_IGNORED : 0);
+		if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+		{
+			if (waitForAll)
+			{
+				continue;
+			}
+			break;
+		}
+
+		numWritten += write_slot(slot) ? 1 : 0;
+	}
+
+	return numWritten;
+}
+
+void OffscreenTarget::clearTarget()
+{
+	for (ReadbackSlot &slot : slots)
+	{
+		if (slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		glDeleteBuffers(1, &slot.buffer);
+	}
+	slots.clear();
+
+	glDeleteRenderbuffers(1, &color_buffer);
+	glDeleteRenderbuffers(1, &depth_buffer);
+	glDeleteFramebuffers(1, &framebuffer_ID);
+	color_buffer = 0;
+	depth_buffer = 0;
+	framebuffer_ID = 0;
+}
+
+int OffscreenTarget::getWidth() const
+{
+	return width;
+}
+
+int OffscreenTarget::getHeight() const
+{
+	return height;
+}
+
+// Maps a finished readback slot and writes it to disk, the fence must have signaled
+bool OffscreenTarget::write_slot(ReadbackSlot &slot)
+{
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+	bool written = false;
+	if (pixels)
+	{
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), "_%04u.%s", slot.frame_number, raw_output ? "rgba" : "ppm");
+		written = write_image(output_prefix + suffix, pixels);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return written;
+}
+
+// Raw output is the RGBA buffer exactly as GL returned it (bottom row first), PPM is flipped to top row first and drops alpha
+bool OffscreenTarget::write_image(const std::string &filePath, const unsigned char* pixels)
+{
+	std::ofstream file(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to open " << filePath << " for writing" << std::endl;
+		return false;
+	}
+
+	if (raw_output)
+	{
+		file.write((const char*)pixels, (std::streamsize)width * height * 4);
+	}
+	else
+	{
+		file << "P6\n" << width << " " << height << "\n255\n";
+		row_buffer.resize((size_t)width * 3);
+		for (int y = height - 1; y >= 0; y--)
+		{
+			const unsigned char* row = pixels + (size_t)y * width * 4;
+			for (int x = 0; x < width; x++)
+			{
+				row_buffer[x * 3 + 0] = row[x * 4 + 0];
+				row_buffer[x * 3 + 1] = row[x * 4 + 1];
+				row_buffer[x * 3 + 2] = row[x * 4 + 2];
+			}
+			file.write((const char*)row_buffer.data(), (std::streamsize)row_buffer.size());
+		}
+	}
+
+	return true;
+}
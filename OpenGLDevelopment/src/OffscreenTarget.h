@@ -0,0 +1,51 @@
+#ifndef OFFSCREENTARGET_H
+#define OFFSCREENTARGET_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+
+// Framebuffer object to render into without a window, with asynchronous readback of finished frames
+// Each readback goes into its own GL_PIXEL_PACK_BUFFER with a fence, and is only mapped and written to disk once the
+// GPU has finished it, so the render loop never waits on glReadPixels
+class OffscreenTarget
+{
+public:
+	OffscreenTarget();
+	~OffscreenTarget();
+
+	// outputPrefix "out/frame" writes out/frame_0000.ppm, ... (or .rgba raw buffers if rawOutput is set)
+	bool create(int width, int height, const std::string &outputPrefix, bool rawOutput = false, unsigned int numReadbackSlots = 3);
+	void bind(GLStateCache &state) const;	// the viewport goes through the cache so it stays in sync
+	void readback(unsigned int frameNumber);	// queue a copy of the current contents
+	unsigned int collect(bool waitForAll);		// write every finished readback, returns the number written
+	void clearTarget();
+
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	struct ReadbackSlot
+	{
+		GLuint buffer;
+		GLsync fence;
+		unsigned int frame_number;
+	};
+
+	GLuint framebuffer_ID, color_buffer, depth_buffer;
+	int width, height;
+	std::string output_prefix;
+	bool raw_output;
+	std::vector<ReadbackSlot> slots;
+	unsigned int next_slot;
+	std::vector<unsigned char> row_buffer;
+
+	bool write_slot(ReadbackSlot &slot);
+	bool write_image(const std::string &filePath, const unsigned char* pixels);
+};
+
+#endif // !OFFSCREENTARGET_H
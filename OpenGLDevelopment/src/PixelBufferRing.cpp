@@ -0,0 +1,246 @@
+#include "PixelBufferRing.h"
+
+#include <cstring>
+#include <algorithm>
+
+PixelBufferRing::PixelBufferRing()
+{
+	grow_size = 0;
+	num_stalls = 0;
+}
+
+PixelBufferRing::~PixelBufferRing()
+{
+
+}
+
+// Allocates numSlots pixel buffers of slotSize bytes each and maps them, slots grow on demand if a bigger image comes along
+void PixelBufferRing::create(unsigned int numSlots, GLsizeiptr slotSize)
+{
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+		slots.resize(numSlots);
+		for (Slot &slot : slots)
+		{
+			glGenBuffers(1, &slot.buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, slotSize, NULL, GL_STREAM_DRAW);
+			slot.size = slotSize;
+			slot.fence = 0;
+			slot.state = SlotState::Idle;
+			slot.mapped = NULL;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	mapFreeSlots();
+}
+
+bool PixelBufferRing::uploadTexture(Texture &texture, const unsigned char* pixels, int width, int height, int numChannels)
+{
+	mapFreeSlots();
+
+	GLsizeiptr size = (GLsizeiptr)width * height * numChannels;
+	unsigned char* data = NULL;
+	int slot = acquireSlot(size, &data);
+	if (slot < 0)
+	{
+		return false;
+	}
+
+	memcpy(data, pixels, size);
+	finishSlot(slot);
+	return uploadSlot(slot, texture, width, height, numChannels, 1);
+}
+
+bool PixelBufferRing::updateTexture(Texture &texture, const unsigned char* pixels)
+{
+	mapFreeSlots();
+
+	GLsizeiptr size = (GLsizeiptr)texture.getWidth() * texture.getHeight() * texture.getNumChannels();
+	unsigned char* data = NULL;
+	int slot = acquireSlot(size, &data);
+	if (slot < 0)
+	{
+		return false;
+	}
+
+	memcpy(data, pixels, size);
+	finishSlot(slot);
+
+	if (!unmap_slot(slots[slot]))
+	{
+		return false;
+	}
+	// With a pixel unpack buffer bound the pixel pointer is an offset into that buffer
+	texture.updatePixels(NULL);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	fence_slot(slots[slot]);
+	return true;
+}
+
+void PixelBufferRing::clearRing()
+{
+	std::unique_lock<std::mutex> lock(slot_mutex);
+	write_finished.wait(lock, [this]
+	{
+		return std::none_of(slots.begin(), slots.end(), [](const Slot &slot) { return slot.state == SlotState::Writing; });
+	});
+
+	for (Slot &slot : slots)
+	{
+		if (slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		glDeleteBuffers(1, &slot.buffer);	// unmaps it too
+	}
+	slots.clear();
+	grow_size = 0;
+}
+
+// Maps every idle slot the GPU has finished reading, without waiting for the ones it has not. Only a slot that
+// nobody is writing can be resized, so a request that found every mapped slot too small grows one here
+void PixelBufferRing::mapFreeSlots()
+{
+	std::lock_guard<std::mutex> lock(slot_mutex);
+	for (Slot &slot : slots)
+	{
+		if (slot.state == SlotState::Mapped && slot.size < grow_size)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			slot.mapped = NULL;
+			slot.state = SlotState::Idle;
+		}
+		if (slot.state != SlotState::Idle)
+		{
+			continue;
+		}
+
+		if (slot.fence)
+		{
+			if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			{
+				continue;
+			}
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+		if (slot.size < grow_size)
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, grow_size, NULL, GL_STREAM_DRAW);
+			slot.size = grow_size;
+			grow_size = 0;
+		}
+
+		// The fence guarantees the GPU is done reading this slot, so the map does not need to synchronize
+		slot.mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slot.size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (!slot.mapped)
+		{
+			std::cout << "Error in PixelBufferRing::mapFreeSlots --> failed to map pixel buffer " << slot.buffer << std::endl;
+			continue;
+		}
+		slot.state = SlotState::Mapped;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// Unmaps a written slot and creates the texture from it, the slot is mapped again by a later mapFreeSlots once the GPU
+// has read it. Returns false if the contents were lost while the slot was mapped
+bool PixelBufferRing::uploadSlot(int slot, Texture &texture, int width, int height, int numChannels, unsigned int numLevels)
+{
+	if (slot < 0 || slot >= (int)slots.size())
+	{
+		std::cout << "Error in PixelBufferRing::uploadSlot --> slot " << slot << " is out of range (" << slots.size() << " slots)" << std::endl;
+		return false;
+	}
+
+	if (!unmap_slot(slots[slot]))
+	{
+		return false;
+	}
+	texture.createFromPackedLevels(NULL, width, height, numChannels, numLevels);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	fence_slot(slots[slot]);
+	return true;
+}
+
+int PixelBufferRing::acquireSlot(GLsizeiptr size, unsigned char** data)
+{
+	std::lock_guard<std::mutex> lock(slot_mutex);
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].state == SlotState::Mapped && slots[i].size >= size)
+		{
+			slots[i].state = SlotState::Writing;
+			*data = slots[i].mapped;
+			return (int)i;
+		}
+	}
+
+	num_stalls++;
+	grow_size = std::max(grow_size, size);
+	return -1;
+}
+
+void PixelBufferRing::finishSlot(int slot)
+{
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+		if (slot >= 0 && slot < (int)slots.size())
+		{
+			slots[slot].state = SlotState::Written;
+		}
+	}
+	write_finished.notify_all();
+}
+
+// The slot stays mapped, so it is free to acquire again right away
+void PixelBufferRing::returnSlot(int slot)
+{
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+		if (slot >= 0 && slot < (int)slots.size())
+		{
+			slots[slot].state = SlotState::Mapped;
+		}
+	}
+	write_finished.notify_all();
+}
+
+// Number of times no mapped slot was free for an upload, which then went from client memory instead. If this keeps
+// growing the ring is too shallow or its slots too small
+unsigned int PixelBufferRing::getNumStalls() const
+{
+	return num_stalls.load(std::memory_order_relaxed);
+}
+
+// Leaves the slot bound as the unpack buffer if the unmap succeeded
+bool PixelBufferRing::unmap_slot(Slot &slot)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+	GLboolean intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+		slot.mapped = NULL;
+		slot.state = SlotState::Idle;
+	}
+
+	if (!intact)
+	{
+		std::cout << "Error in PixelBufferRing --> pixel buffer " << slot.buffer << " lost its contents while mapped" << std::endl;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return false;
+	}
+	return true;
+}
+
+void PixelBufferRing::fence_slot(Slot &slot)
+{
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
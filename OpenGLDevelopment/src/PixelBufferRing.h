@@ -0,0 +1,69 @@
+#ifndef PIXELBUFFERRING_H
+#define PIXELBUFFERRING_H
+
+#include <vector>
+#include <iostream>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <glad/glad.h>
+
+#include "Texture.h"
+
+// Ring of GL_PIXEL_UNPACK_BUFFER objects used to stream pixel data into textures without a synchronous driver copy
+// The GL thread keeps every slot the GPU has finished with mapped, pixels are written straight into a mapped slot (by
+// any thread, see acquireSlot), and uploading it is only an unmap and a glTexImage2D that reads from the buffer.
+// A fence per slot tells us when the GPU is done with it and it can be mapped again
+class PixelBufferRing
+{
+public:
+	PixelBufferRing();
+	~PixelBufferRing();
+
+	void create(unsigned int numSlots, GLsizeiptr slotSize);
+	bool uploadTexture(Texture &texture, const unsigned char* pixels, int width, int height, int numChannels);	// (re)creates the texture storage
+	bool updateTexture(Texture &texture, const unsigned char* pixels);	// same size update, e.g. video frames
+	void clearRing();	// waits for writes into acquired slots to finish
+
+	// GL thread. mapFreeSlots once per frame, uploadSlot for each filled slot, numLevels as in Texture::createFromPackedLevels
+	void mapFreeSlots();
+	bool uploadSlot(int slot, Texture &texture, int width, int height, int numChannels, unsigned int numLevels);
+
+	// Any thread. acquireSlot returns -1 if no mapped slot of at least size bytes is free, otherwise data points at the
+	// mapping until finishSlot. returnSlot hands a slot back without uploading it
+	int acquireSlot(GLsizeiptr size, unsigned char** data);
+	void finishSlot(int slot);
+	void returnSlot(int slot);
+
+	unsigned int getNumStalls() const;
+
+private:
+	enum class SlotState
+	{
+		Idle,	// unmapped, possibly still read by the GPU (see fence)
+		Mapped,	// free to acquire
+		Writing,
+		Written
+	};
+
+	struct Slot
+	{
+		GLuint buffer;
+		GLsizeiptr size;
+		GLsync fence;
+		SlotState state;
+		unsigned char* mapped;
+	};
+
+	std::vector<Slot> slots;	// states and sizes guarded by slot_mutex
+	std::mutex slot_mutex;
+	std::condition_variable write_finished;
+	GLsizeiptr grow_size;	// guarded by slot_mutex, the next slot mapped gets at least this much storage
+	std::atomic<unsigned int> num_stalls;
+
+	bool unmap_slot(Slot &slot);
+	void fence_slot(Slot &slot);
+};
+
+#endif // !PIXELBUFFERRING_H
@@ -0,0 +1,139 @@
+#include "RenderQueue.h"
+
+RenderQueue::RenderQueue()
+{
+
+}
+
+RenderQueue::~RenderQueue()
+{
+
+}
+
+void RenderQueue::submit(RenderPass pass, GLuint program, GLuint vertexArray, GLuint texture, GLsizei indexCount,
+	GLenum indexType, uintptr_t indexOffset, GLenum primitive, GLenum textureTarget, GLuint sampler)
+{
+	submitInstanced(pass, program, vertexArray, texture, indexCount, 1, indexType, indexOffset, primitive, textureTarget, sampler);
+}
+
+// The VAO must carry the per instance attributes (see InstanceBuffer)
+void RenderQueue::submitInstanced(RenderPass pass, GLuint program, GLuint vertexArray, GLuint texture, GLsizei indexCount, GLsizei instanceCount,
+	GLenum indexType, uintptr_t indexOffset, GLenum primitive, GLenum textureTarget, GLuint sampler)
+{
+	if (instanceCount <= 0)
+	{
+		return;
+	}
+
+	RenderCommand command;
+	command.key = makeKey(pass, program, texture, vertexArray);
+	command.program = program;
+	command.vertex_array = vertexArray;
+	command.texture = texture;
+	command.texture_target = textureTarget;
+	command.sampler = sampler;
+	command.primitive = primitive;
+	command.index_type = indexType;
+	command.index_count = indexCount;
+	command.instance_count = instanceCount;
+	command.index_offset = indexOffset;
+	commands.push_back(command);
+}
+
+void RenderQueue::execute(GLStateCache &state)
+{
+	if (commands.empty())
+	{
+		return;
+	}
+
+	radix_sort();
+
+	// Sorted commands share state with their neighbours, so the cache turns most of these into no-ops
+	for (const SortEntry &entry : sorted)
+	{
+		const RenderCommand &command = commands[entry.command];
+		state.useProgram(command.program);
+		state.bindVertexArray(command.vertex_array);
+		state.bindTexture(0, command.texture_target, command.texture);
+		state.bindSampler(0, command.sampler);
+
+		if (command.instance_count == 1)
+		{
+			glDrawElements(command.primitive, command.index_count, command.index_type, (const void*)command.index_offset);
+		}
+		else
+		{
+			glDrawElementsInstanced(command.primitive, command.index_count, command.index_type, (const void*)command.index_offset, command.instance_count);
+		}
+	}
+
+	clear();
+}
+
+void RenderQueue::clear()
+{
+	commands.clear();
+	sorted.clear();
+}
+
+unsigned int RenderQueue::getNumCommands() const
+{
+	return (unsigned int)commands.size();
+}
+
+uint64_t RenderQueue::makeKey(RenderPass pass, GLuint program, GLuint texture, GLuint vertexArray)
+{
+	return ((uint64_t)(pass & 0xFF) << 56)
+		| ((uint64_t)(program & 0xFFFF) << 40)
+		| ((uint64_t)(texture & 0xFFFFF) << 20)
+		| (uint64_t)(vertexArray & 0xFFFFF);
+}
+
+// LSD radix sort on the keys, one byte per pass. All eight histograms are built in a single read of the keys, and a
+// byte that is the same in every key (common, since most draws share a pass and a handful of programs) skips its pass
+void RenderQueue::radix_sort()
+{
+	const size_t count = commands.size();
+	sorted.resize(count);
+	scratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		sorted[i].key = commands[i].key;
+		sorted[i].command = (uint32_t)i;
+	}
+
+	uint32_t histograms[8][256] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = sorted[i].key;
+		for (int digit = 0; digit < 8; digit++)
+		{
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	for (int digit = 0; digit < 8; digit++)
+	{
+		uint32_t* histogram = histograms[digit];
+		if (histogram[(sorted[0].key >> (digit * 8)) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		// Turn the counts into starting offsets
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[histogram[(sorted[i].key >> (digit * 8)) & 0xFF]++] = sorted[i];
+		}
+		sorted.swap(scratch);
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+
+// Passes run in this order, everything in a pass is drawn before anything in the next one
+enum RenderPass
+{
+	OPAQUE_PASS = 0,
+	TRANSPARENT_PASS = 1,
+	OVERLAY_PASS = 2
+};
+
+// One indexed draw (instanced when instance_count is not 1), plain data so a frame's worth of them can be copied and sorted cheaply
+struct RenderCommand
+{
+	uint64_t key;
+	GLuint program;
+	GLuint vertex_array;
+	GLuint texture;		// bound to unit 0, 0 for none
+	GLenum texture_target;	// GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for a TextureArray
+	GLuint sampler;		// bound to unit 0 with the texture (see SamplerCache)
+	GLenum primitive;
+	GLenum index_type;
+	GLsizei index_count;
+	GLsizei instance_count;
+	uintptr_t index_offset;	// byte offset into the VAO's element buffer
+};
+
+// Collects draws during the frame, then sorts them by state and issues them in one pass through a GLStateCache, so the
+// program, VAO and texture are only rebound when they actually change. Sort key layout, most significant first:
+//   pass (8 bits) | program (16 bits) | texture (20 bits) | vertex array (20 bits)
+// GL object names are small integers, so names beyond a field's range only cost some sorting quality
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	void submit(RenderPass pass, GLuint program, GLuint vertexArray, GLuint texture, GLsizei indexCount,
+		GLenum indexType = GL_UNSIGNED_INT, uintptr_t indexOffset = 0, GLenum primitive = GL_TRIANGLES, GLenum textureTarget = GL_TEXTURE_2D, GLuint sampler = 0);
+	void submitInstanced(RenderPass pass, GLuint program, GLuint vertexArray, GLuint texture, GLsizei indexCount, GLsizei instanceCount,
+		GLenum indexType = GL_UNSIGNED_INT, uintptr_t indexOffset = 0, GLenum primitive = GL_TRIANGLES, GLenum textureTarget = GL_TEXTURE_2D, GLuint sampler = 0);
+	void execute(GLStateCache &state);	// sorts, draws and empties the queue
+	void clear();
+
+	unsigned int getNumCommands() const;
+
+	static uint64_t makeKey(RenderPass pass, GLuint program, GLuint texture, GLuint vertexArray);
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t command;
+	};
+
+	std::vector<RenderCommand> commands;
+	std::vector<SortEntry> sorted, scratch;	// kept between frames so a steady state frame allocates nothing
+
+	void radix_sort();
+};
+
+#endif // !RENDERQUEUE_H
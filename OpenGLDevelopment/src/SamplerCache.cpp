@@ -0,0 +1,104 @@
+#include "SamplerCache.h"
+
+#include <algorithm>
+
+#include "GLExtensions.h"
+
+SamplerCache::SamplerCache()
+{
+	max_supported_anisotropy = 0.0f;
+	num_requests = 0;
+}
+
+SamplerCache::~SamplerCache()
+{
+
+}
+
+GLuint SamplerCache::get(const SamplerDesc &requested)
+{
+	num_requests++;
+	SamplerDesc desc = normalize(requested);
+	for (const Entry &entry : entries)
+	{
+		if (same_desc(entry.desc, desc))
+		{
+			return entry.sampler;
+		}
+	}
+
+	Entry entry;
+	entry.desc = desc;
+	glGenSamplers(1, &entry.sampler);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_MIN_FILTER, desc.min_filter);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_MAG_FILTER, desc.mag_filter);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_S, desc.wrap_s);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_T, desc.wrap_t);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_R, desc.wrap_r);
+	if (desc.max_anisotropy > 1.0f)
+	{
+		glSamplerParameterf(entry.sampler, GLEXT_TEXTURE_MAX_ANISOTROPY, desc.max_anisotropy);
+	}
+	entries.push_back(entry);
+	return entry.sampler;
+}
+
+void SamplerCache::bind(GLStateCache &state, GLuint unit, const SamplerDesc &desc)
+{
+	state.bindSampler(unit, get(desc));
+}
+
+// Any GLStateCache that has these bound must be invalidated, the names can be handed out again
+void SamplerCache::clearCache()
+{
+	for (const Entry &entry : entries)
+	{
+		glDeleteSamplers(1, &entry.sampler);
+	}
+	entries.clear();
+}
+
+unsigned int SamplerCache::getNumSamplers() const
+{
+	return (unsigned int)entries.size();
+}
+
+unsigned int SamplerCache::getNumRequests() const
+{
+	return num_requests;
+}
+
+SamplerDesc SamplerCache::makeDesc(GLenum minFilter, GLenum magFilter, GLenum wrap, float maxAnisotropy)
+{
+	SamplerDesc desc;
+	desc.min_filter = minFilter;
+	desc.mag_filter = magFilter;
+	desc.wrap_s = wrap;
+	desc.wrap_t = wrap;
+	desc.wrap_r = wrap;
+	desc.max_anisotropy = maxAnisotropy;
+	return desc;
+}
+
+// Descriptors that end up as the same GL state (anisotropy beyond what the driver supports) share a sampler
+SamplerDesc SamplerCache::normalize(const SamplerDesc &requested)
+{
+	if (max_supported_anisotropy == 0.0f)
+	{
+		max_supported_anisotropy = 1.0f;
+		if (GLExtensions::hasTextureFilterAnisotropic())
+		{
+			glGetFloatv(GLEXT_MAX_TEXTURE_MAX_ANISOTROPY, &max_supported_anisotropy);
+		}
+	}
+
+	SamplerDesc desc = requested;
+	desc.max_anisotropy = std::min(std::max(desc.max_anisotropy, 1.0f), max_supported_anisotropy);
+	return desc;
+}
+
+bool SamplerCache::same_desc(const SamplerDesc &a, const SamplerDesc &b)
+{
+	return a.min_filter == b.min_filter && a.mag_filter == b.mag_filter && a.wrap_s == b.wrap_s && a.wrap_t == b.wrap_t
+		&& a.wrap_r == b.wrap_r && a.max_anisotropy == b.max_anisotropy;
+}
@@ -0,0 +1,52 @@
+#ifndef SAMPLERCACHE_H
+#define SAMPLERCACHE_H
+
+#include <vector>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+
+// Filtering and wrapping for one way of sampling a texture
+struct SamplerDesc
+{
+	GLenum min_filter, mag_filter;
+	GLenum wrap_s, wrap_t, wrap_r;
+	float max_anisotropy;	// 1 for none, clamped to what the driver supports
+};
+
+// Hands out one sampler object per distinct SamplerDesc. Textures only keep their images and level range, how they
+// are filtered comes from the sampler bound to the same unit, so the same image can be sampled in different ways
+// without touching its parameters, and every texture that is sampled the same way shares a single sampler
+class SamplerCache
+{
+public:
+	SamplerCache();
+	~SamplerCache();
+
+	GLuint get(const SamplerDesc &desc);	// created on first request, the same name every time after that
+	void bind(GLStateCache &state, GLuint unit, const SamplerDesc &desc);
+	void clearCache();
+
+	unsigned int getNumSamplers() const;
+	unsigned int getNumRequests() const;
+
+	static SamplerDesc makeDesc(GLenum minFilter, GLenum magFilter, GLenum wrap, float maxAnisotropy = 1.0f);
+
+private:
+	struct Entry
+	{
+		SamplerDesc desc;
+		GLuint sampler;
+	};
+
+	std::vector<Entry> entries;	// a handful at most, a linear search beats hashing
+	float max_supported_anisotropy;	// 0 until queried
+	unsigned int num_requests;
+
+	SamplerDesc normalize(const SamplerDesc &desc);
+	static bool same_desc(const SamplerDesc &a, const SamplerDesc &b);
+};
+
+#endif // !SAMPLERCACHE_H
@@ -1,16 +1,26 @@
 #include "Shader.h"
 
+#include <cstring>
+#include <algorithm>
+
+#include "CpuProfiler.h"
+#include "GLExtensions.h"
+
+ShaderCache* Shader::program_cache = NULL;
+ShaderPreprocessor Shader::preprocessor;
+
 Shader::Shader()
 {
 	shader_ID = 0;
 	uniform_model = 0;
 	uniform_projection = 0;
+	uniform_view = 0;
+	uniform_locations.clear();
 }
 
-Shader::Shader(const GLchar* vertexPath, const GLchar* fragPath)
+Shader::Shader(const GLchar* vertexPath, const GLchar* fragPath, const std::vector<std::string> &defines) : Shader()
 {
-	Shader();
-	createFromFiles(vertexPath, fragPath);
+	createFromFiles(vertexPath, fragPath, defines);
 }
 
 Shader::~Shader()
@@ -21,116 +31,315 @@ Shader::~Shader()
 
 void Shader::createFromString(const GLchar* vertexCode, const GLchar* fragmentCode)
 {
-	compile_and_link_shader(vertexCode, fragmentCode);
+	compile_and_link_shader(vertexCode, (GLint)strlen(vertexCode), fragmentCode, (GLint)strlen(fragmentCode));
 }
 
-void Shader::createFromFiles(const char* vertexLocation, const char* fragmentLocation)
+// Builds the shader from files, resolving #include directives and adding a #define for every entry of defines
+void Shader::createFromFiles(const char* vertexLocation, const char* fragmentLocation, const std::vector<std::string> &defines)
 {
-	std::string vertStream = readFile(vertexLocation);
-	std::string fragStream = readFile(fragmentLocation);
+	vertex_path = vertexLocation;
+	fragment_path = fragmentLocation;
+	this->defines = defines;
 
-	const GLchar* vertCode = vertStream.c_str();
-	const GLchar* fragCode = fragStream.c_str();
+	std::string vertCode, fragCode;
+	if (!preprocessFiles(vertex_path, fragment_path, defines, vertCode, fragCode, &dependencies))
+	{
+		return;
+	}
 
-	compile_and_link_shader(vertCode, fragCode);
+	compile_and_link_shader(vertCode.data(), (GLint)vertCode.size(), fragCode.data(), (GLint)fragCode.size());
 }
 
-std::string Shader::readFile(const char* fileLocation)
+// Reads the whole file into contents with a single allocation and a single read, returns false if it could not be read
+bool Shader::readFile(const char* fileLocation, std::string &contents)
 {
-	std::string contentRead;
-	std::ifstream fileStream(fileLocation, std::ios::in);
-
+	std::ifstream fileStream(fileLocation, std::ios::in | std::ios::binary | std::ios::ate);
 	if (!fileStream.is_open())
 	{
 		std::cout << "Failed to open file: " << fileLocation << std::endl;
-		return NULL;
+		return false;
 	}
-	else
+
+	std::streamoff size = fileStream.tellg();
+	if (size < 0)
 	{
-		std::string line = "";
-		while (!fileStream.eof())
-		{
-			std::getline(fileStream, line); //This is probably inefficient? -- TODO: change to sstream reading or something
-			contentRead.append(line + "\n");
-		}
+		std::cout << "Failed to read file: " << fileLocation << std::endl;
+		return false;
+	}
 
-		fileStream.close();
-		return contentRead;
+	contents.resize((size_t)size);
+	fileStream.seekg(0, std::ios::beg);
+	if (size > 0 && !fileStream.read(&contents[0], size))
+	{
+		std::cout << "Failed to read file: " << fileLocation << std::endl;
+		contents.clear();
+		return false;
 	}
+
+	return true;
 }
 
-// Compiles, links, and validates the shaders given by vertexCode and fragmentCode parameters
-void Shader::compile_and_link_shader(const GLchar* vertexCode, const GLchar* fragmentCode)
+// Runs both stages through the shared preprocessor, whose include cache makes repeated permutations cheap
+bool Shader::preprocessFiles(const std::string &vertexLocation, const std::string &fragmentLocation, const std::vector<std::string> &defines,
+	std::string &vertexCode, std::string &fragmentCode, std::vector<std::string>* dependencies)
 {
-	// error checking variables
-	GLint result = 0;
-	GLchar errorLog[1024] = { 0 };
+	std::vector<std::string> vertexFiles, fragmentFiles;
+	if (!preprocessor.process(vertexLocation, defines, vertexCode, &vertexFiles) || !preprocessor.process(fragmentLocation, defines, fragmentCode, &fragmentFiles))
+	{
+		return false;
+	}
 
-	// Create the shader program
-	this->shader_ID = glCreateProgram();
-	if (!shader_ID)
+	if (dependencies)
 	{
-		glGetProgramInfoLog(shader_ID, sizeof(errorLog), NULL, errorLog);
-		std::cout << "Error creating shader program: " << errorLog << std::endl;
-		return;
+		dependencies->swap(vertexFiles);
+		for (const std::string &file : fragmentFiles)
+		{
+			if (std::find(dependencies->begin(), dependencies->end(), file) == dependencies->end())
+			{
+				dependencies->push_back(file);
+			}
+		}
 	}
+	return true;
+}
 
-	// Compile vertex shader
-	GLuint vertShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertShader, 1, &vertexCode, NULL);
-	glCompileShader(vertShader);
-	glGetShaderiv(vertShader, GL_COMPILE_STATUS, &result);
-	if (!result)
+// Compiles, links, and validates the shaders given by vertexCode and fragmentCode parameters
+// Sources are passed with explicit lengths, they do not need to be null terminated
+void Shader::compile_and_link_shader(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength)
+{
+	CPU_PROFILE_ZONE("Shader::compile_and_link_shader");
+	shader_ID = build_program(vertexCode, vertexLength, fragmentCode, fragmentLength);
+	if (shader_ID)
 	{
-		glGetShaderInfoLog(vertShader, sizeof(errorLog), NULL, errorLog);
-		std::cout << "Error compiling vertex shader: " << errorLog << std::endl;
-		return;
+		// Set references to uniform variables
+		setup_linked_program();
 	}
+}
 
-	// Compile fragment shader
-	GLuint fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragShader, 1, &fragmentCode, NULL);
-	glCompileShader(fragShader);
-	glGetShaderiv(fragShader, GL_COMPILE_STATUS, &result);
-	if (!result)
+// Builds a complete program from source without touching shader_ID, so a failed build never replaces a working program
+// Returns 0 if anything fails, after deleting every GL object it created
+GLuint Shader::build_program(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength)
+{
+	uint64_t cacheKey = 0;
+	bool fromCache = false;
+	GLuint program = begin_program(vertexCode, vertexLength, fragmentCode, fragmentLength, cacheKey, fromCache);
+	if (!program || fromCache)
 	{
-		glGetShaderInfoLog(fragShader, sizeof(errorLog), NULL, errorLog);
-		std::cout << "Error compiling fragment shader: " << errorLog << std::endl;
-		return;
+		return program;
 	}
 
+	GLuint vertShader = submit_stage(GL_VERTEX_SHADER, vertexCode, vertexLength);
+	GLuint fragShader = submit_stage(GL_FRAGMENT_SHADER, fragmentCode, fragmentLength);
+
 	// Attach both shaders to the shader program
-	glAttachShader(shader_ID, vertShader);
-	glAttachShader(shader_ID, fragShader);
+	glAttachShader(program, vertShader);
+	glAttachShader(program, fragShader);
 	
 	// Link the shader program
-	glLinkProgram(shader_ID);
-	glGetProgramiv(shader_ID, GL_LINK_STATUS, &result);
+	glLinkProgram(program);
+
+	return finish_program(program, vertShader, fragShader, cacheKey) ? program : 0;
+}
+
+// Creates the program object, and links it straight from the program cache if this exact source was linked before
+GLuint Shader::begin_program(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength, uint64_t &cacheKey, bool &fromCache)
+{
+	fromCache = false;
+
+	// Create the shader program
+	GLuint program = glCreateProgram();
+	if (!program)
+	{
+		std::cout << "Error creating shader program" << std::endl;
+		return 0;
+	}
+
+	// Skip compiling entirely if this exact source has been linked by this driver before
+	if (program_cache && program_cache->isAvailable())
+	{
+		cacheKey = program_cache->computeKey(vertexCode, vertexLength, fragmentCode, fragmentLength);
+		if (program_cache->loadProgram(cacheKey, program))
+		{
+			fromCache = true;
+			return program;
+		}
+
+		// A rejected binary can leave the program in a failed state, start over with a fresh one
+		glDeleteProgram(program);
+		program = glCreateProgram();
+		GLExtensions::ProgramParameteri(program, GLEXT_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	return program;
+}
+
+// Kicks off compilation of one stage without asking for the result, so the driver is free to compile in the background
+GLuint Shader::submit_stage(GLenum stageType, const GLchar* code, GLint length)
+{
+	GLuint stage = glCreateShader(stageType);
+	glShaderSource(stage, 1, &code, &length);
+	glCompileShader(stage);
+	return stage;
+}
+
+// Checks the link result of a program whose stages were compiled with submit_stage, reporting compile errors per stage
+// On success the binary is stored in the program cache, on failure the program is deleted. The stages are always deleted
+bool Shader::finish_program(GLuint program, GLuint vertShader, GLuint fragShader, uint64_t cacheKey)
+{
+	// error checking variables
+	GLint result = 0;
+	GLchar errorLog[1024] = { 0 };
+
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
 	if (!result)
 	{
-		glGetProgramInfoLog(shader_ID, sizeof(errorLog), NULL, errorLog);
+		glGetShaderiv(vertShader, GL_COMPILE_STATUS, &result);
+		if (!result)
+		{
+			glGetShaderInfoLog(vertShader, sizeof(errorLog), NULL, errorLog);
+			std::cout << "Error compiling vertex shader: " << errorLog << std::endl;
+		}
+
+		glGetShaderiv(fragShader, GL_COMPILE_STATUS, &result);
+		if (!result)
+		{
+			glGetShaderInfoLog(fragShader, sizeof(errorLog), NULL, errorLog);
+			std::cout << "Error compiling fragment shader: " << errorLog << std::endl;
+		}
+
+		glGetProgramInfoLog(program, sizeof(errorLog), NULL, errorLog);
 		std::cout << "Error linking program: " << errorLog << std::endl;
-		return;
+
+		glDeleteShader(vertShader);
+		glDeleteShader(fragShader);
+		glDeleteProgram(program);
+		return false;
 	}
 
-	// Validate the shader program
-	glValidateProgram(shader_ID);
-	glGetProgramiv(shader_ID, GL_VALIDATE_STATUS, &result);
+	// Can delete the shaders after they have been linked into the program
+	glDeleteShader(vertShader);
+	glDeleteShader(fragShader);
+
+	// Validate the shader program, this depends on the current GL state so a failure is only reported
+	glValidateProgram(program);
+	glGetProgramiv(program, GL_VALIDATE_STATUS, &result);
 	if (!result)
 	{
-		glGetProgramInfoLog(shader_ID, sizeof(errorLog), NULL, errorLog);
+		glGetProgramInfoLog(program, sizeof(errorLog), NULL, errorLog);
 		std::cout << "Error validating shader program: " << errorLog << std::endl;
-		return;
 	}
 
-	// Set references to uniform variables
-	uniform_model = glGetUniformLocation(shader_ID, "model");
-	uniform_projection = glGetUniformLocation(shader_ID, "projection");
-	uniform_view = glGetUniformLocation(shader_ID, "view");
+	if (program_cache && program_cache->isAvailable())
+	{
+		program_cache->storeProgram(cacheKey, program);
+	}
+
+	return true;
+}
 
-	// Can delete the shaders after they have been linked into the program
-	glDeleteShader(vertShader);
-	glDeleteShader(fragShader);
+// Rebuilds the program from new source and swaps it in only if it linked, the old program stays in use otherwise
+// Uniform handles resolved before a successful reload must be resolved again
+bool Shader::reloadFromString(const std::string &vertexCode, const std::string &fragmentCode)
+{
+	GLuint program = build_program(vertexCode.data(), (GLint)vertexCode.size(), fragmentCode.data(), (GLint)fragmentCode.size());
+	if (!program)
+	{
+		std::cout << "Shader reload failed, keeping program " << shader_ID << std::endl;
+		return false;
+	}
+
+	replace_program(program);
+	return true;
+}
+
+// Takes ownership of a freshly linked program, the one it replaces is deleted
+void Shader::replace_program(GLuint program)
+{
+	if (shader_ID && shader_ID != program)
+	{
+		glDeleteProgram(shader_ID);
+	}
+	shader_ID = program;
+	setup_linked_program();
+}
+
+// Everything that has to happen once a new program is in shader_ID
+void Shader::setup_linked_program()
+{
+	cache_uniform_locations();
+	bind_uniform_blocks();
+}
+
+// Binds the shared uniform blocks (FrameUniforms, CameraUniforms, ...) the program uses to their fixed binding points,
+// so programs pick up the per frame buffers without any per program uniform calls
+void Shader::bind_uniform_blocks()
+{
+	for (GLuint binding = 0; UniformBuffer::blockNameForBinding(binding); binding++)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(shader_ID, UniformBuffer::blockNameForBinding(binding));
+		if (blockIndex == GL_INVALID_INDEX)
+		{
+			continue;
+		}
+
+		GLint blockSize = 0;
+		glGetActiveUniformBlockiv(shader_ID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+		if (blockSize != UniformBuffer::blockSizeForBinding(binding))
+		{
+			std::cout << "Warning: uniform block " << UniformBuffer::blockNameForBinding(binding) << " in shader program " << shader_ID << " is " << blockSize
+				<< " bytes, expected " << UniformBuffer::blockSizeForBinding(binding) << std::endl;
+		}
+
+		glUniformBlockBinding(shader_ID, blockIndex, binding);
+	}
+}
+
+// Enumerates the active uniforms of the linked program once, so setters never have to ask the driver for a location again
+void Shader::cache_uniform_locations()
+{
+	uniform_locations.clear();
+
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(shader_ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(shader_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(shader_ID, (GLuint)i, (GLsizei)name.size(), &nameLength, &size, &type, &name[0]);
+
+		std::string uniformName(name.c_str(), nameLength);
+		GLint location = glGetUniformLocation(shader_ID, uniformName.c_str());
+		if (location < 0)
+		{
+			continue; // uniforms inside a uniform block have no location
+		}
+
+		uniform_locations[uniformName] = location;
+
+		// Arrays are reported once as "name[0]", also allow looking them up by the bare name and by every element
+		size_t bracket = uniformName.find('[');
+		if (bracket != std::string::npos)
+		{
+			std::string baseName = uniformName.substr(0, bracket);
+			uniform_locations[baseName] = location;
+			if (uniformName.compare(bracket, std::string::npos, "[0]") == 0)
+			{
+				for (GLint element = 1; element < size; element++)
+				{
+					std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					uniform_locations[elementName] = glGetUniformLocation(shader_ID, elementName.c_str());
+				}
+			}
+		}
+	}
+
+	uniform_model = getUniformHandle("model");
+	uniform_projection = getUniformHandle("projection");
+	uniform_view = getUniformHandle("view");
 }
 
 /*	//Combined this funtion into compile_and_link_shader function, left for reference/backup
@@ -183,20 +392,73 @@ GLuint Shader::getID() const
 	return shader_ID;
 }
 
+const std::string& Shader::getVertexPath() const
+{
+	return vertex_path;
+}
+
+const std::string& Shader::getFragmentPath() const
+{
+	return fragment_path;
+}
+
+const std::vector<std::string>& Shader::getDefines() const
+{
+	return defines;
+}
+
+const std::vector<std::string>& Shader::getDependencies() const
+{
+	return dependencies;
+}
+
+// Returns the location of an active uniform, or -1 if the program has no such uniform
+// Resolve handles once outside of hot loops and use the handle based setters below
+GLint Shader::getUniformHandle(const std::string &name) const
+{
+	auto it = uniform_locations.find(name);
+	if (it == uniform_locations.end())
+	{
+		return -1;
+	}
+	return it->second;
+}
+
 // Uniform setting functions
 void Shader::setBool(const std::string &name, bool val) const
 {
-	glUniform1i(glGetUniformLocation(this->shader_ID, name.c_str()), (int)val);
+	glUniform1i(getUniformHandle(name), (int)val);
 }
 
 void Shader::setInt(const std::string &name, int val) const
 {
-	glUniform1i(glGetUniformLocation(this->shader_ID, name.c_str()), val);
+	glUniform1i(getUniformHandle(name), val);
 }
 
 void Shader::setFloat(const std::string &name, float val) const
 {
-	glUniform1f(glGetUniformLocation(this->shader_ID, name.c_str()), val);
+	glUniform1f(getUniformHandle(name), val);
+}
+
+// Handle based uniform setting functions, no string hashing or driver lookups
+void Shader::setBool(GLint handle, bool val) const
+{
+	glUniform1i(handle, (int)val);
+}
+
+void Shader::setInt(GLint handle, int val) const
+{
+	glUniform1i(handle, val);
+}
+
+void Shader::setFloat(GLint handle, float val) const
+{
+	glUniform1f(handle, val);
+}
+
+void Shader::setProgramCache(ShaderCache* cache)
+{
+	program_cache = cache;
 }
 
 void Shader::useShader()
@@ -228,4 +490,5 @@ void Shader::clearShader()
 
 	uniform_model = 0;
 	uniform_projection = 0;
+	uniform_locations.clear();
 }
\ No newline at end of file
@@ -4,34 +4,69 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <unordered_map>
+#include <vector>
 
-#include <glad\glad.h>
+#include <glad/glad.h>
+
+#include "ShaderCache.h"
+#include "ShaderPreprocessor.h"
+#include "UniformBuffer.h"
 
 class Shader
 {
 public:
 	Shader();
-	Shader(const GLchar* vertexPath, const GLchar* fragPath);
+	Shader(const GLchar* vertexPath, const GLchar* fragPath, const std::vector<std::string> &defines = std::vector<std::string>());
 	~Shader();
 
 	void createFromString(const GLchar* vertexCode, const GLchar* fragmentCode);
-	void createFromFiles(const char* vertexLocation, const char* fragmentLocation);
-	std::string readFile(const char* fileLocation);
+	void createFromFiles(const char* vertexLocation, const char* fragmentLocation, const std::vector<std::string> &defines = std::vector<std::string>());
+	bool reloadFromString(const std::string &vertexCode, const std::string &fragmentCode);
+	static bool readFile(const char* fileLocation, std::string &contents);
+	static bool preprocessFiles(const std::string &vertexLocation, const std::string &fragmentLocation, const std::vector<std::string> &defines,
+		std::string &vertexCode, std::string &fragmentCode, std::vector<std::string>* dependencies = NULL);
 	GLuint getProjectionLocation() const;
 	GLuint getModelLocation() const;
 	GLuint getViewLocation() const;
 	GLuint getID() const;
+	const std::string& getVertexPath() const;
+	const std::string& getFragmentPath() const;
+	const std::vector<std::string>& getDefines() const;
+	const std::vector<std::string>& getDependencies() const;
+	GLint getUniformHandle(const std::string &name) const;
 	void setBool(const std::string &name, bool val) const;
 	void setInt(const std::string &name, int val) const;
 	void setFloat(const std::string &name, float val) const;
+	void setBool(GLint handle, bool val) const;
+	void setInt(GLint handle, int val) const;
+	void setFloat(GLint handle, float val) const;
 	void useShader();
 	void clearShader();
 
+	static void setProgramCache(ShaderCache* cache);	// shared by all shaders, NULL disables caching
+
 
 private:
+	friend class ShaderBatch;
+
 	GLuint shader_ID, uniform_projection, uniform_model, uniform_view;
+	std::string vertex_path, fragment_path; // Source files, empty if created from strings
+	std::vector<std::string> defines, dependencies; // Permutation keys, and every file (includes too) the sources were built from
+	std::unordered_map<std::string, GLint> uniform_locations; // Active uniform name -> location, filled once after linking
+
+	static ShaderCache* program_cache;
+	static ShaderPreprocessor preprocessor;
 
-	void compile_and_link_shader(const GLchar* vertexCode, const GLchar* fragmentCode);
+	void compile_and_link_shader(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength);
+	GLuint build_program(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength);
+	static GLuint begin_program(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength, uint64_t &cacheKey, bool &fromCache);
+	static GLuint submit_stage(GLenum stageType, const GLchar* code, GLint length);
+	static bool finish_program(GLuint program, GLuint vertShader, GLuint fragShader, uint64_t cacheKey);
+	void replace_program(GLuint program);
+	void setup_linked_program();
+	void cache_uniform_locations();
+	void bind_uniform_blocks();
 
 	//Combined this funtion into compile_and_link_shader function, left for reference/backup
 	//void add_shader(GLuint theProgram, const GLchar* shaderCode, GLenum shaderType);
@@ -0,0 +1,154 @@
+#include "ShaderBatch.h"
+
+#include <thread>
+
+#include "CpuProfiler.h"
+#include "GLExtensions.h"
+
+ShaderBatch::ShaderBatch()
+{
+
+}
+
+ShaderBatch::~ShaderBatch()
+{
+
+}
+
+void ShaderBatch::add(Shader* shader, const char* vertexLocation, const char* fragmentLocation, const std::vector<std::string> &defines)
+{
+	Entry entry;
+	entry.shader = shader;
+	entry.vertex_path = vertexLocation;
+	entry.fragment_path = fragmentLocation;
+	entry.defines = defines;
+	entry.program = 0;
+	entry.vert_shader = 0;
+	entry.frag_shader = 0;
+	entry.cache_key = 0;
+	entry.done = false;
+	entries.push_back(entry);
+}
+
+unsigned int ShaderBatch::compile()
+{
+	CPU_PROFILE_ZONE("ShaderBatch::compile");
+	if (GLExtensions::hasParallelShaderCompile() && GLExtensions::MaxShaderCompilerThreads)
+	{
+		GLExtensions::MaxShaderCompilerThreads(0xFFFFFFFF); // let the driver pick as many threads as it likes
+	}
+
+	unsigned int numLinked = 0;
+
+	// Submit every compile first, programs found in the program cache are finished right away
+	for (Entry &entry : entries)
+	{
+		if (entry.done)
+		{
+			continue; // built by an earlier compile()
+		}
+
+		entry.shader->vertex_path = entry.vertex_path;
+		entry.shader->fragment_path = entry.fragment_path;
+		entry.shader->defines = entry.defines;
+
+		if (!Shader::preprocessFiles(entry.vertex_path, entry.fragment_path, entry.defines, entry.vertex_code, entry.fragment_code, &entry.dependencies))
+		{
+			entry.done = true;
+			continue;
+		}
+		entry.shader->dependencies = entry.dependencies;
+
+		bool fromCache = false;
+		entry.program = Shader::begin_program(entry.vertex_code.data(), (GLint)entry.vertex_code.size(), entry.fragment_code.data(), (GLint)entry.fragment_code.size(), entry.cache_key, fromCache);
+		if (!entry.program || fromCache)
+		{
+			entry.done = true;
+			if (entry.program)
+			{
+				entry.shader->replace_program(entry.program);
+				numLinked++;
+			}
+			continue;
+		}
+
+		entry.vert_shader = Shader::submit_stage(GL_VERTEX_SHADER, entry.vertex_code.data(), (GLint)entry.vertex_code.size());
+		entry.frag_shader = Shader::submit_stage(GL_FRAGMENT_SHADER, entry.fragment_code.data(), (GLint)entry.fragment_code.size());
+	}
+
+	// Then every link, still without asking for any results
+	for (Entry &entry : entries)
+	{
+		if (!entry.done)
+		{
+			glAttachShader(entry.program, entry.vert_shader);
+			glAttachShader(entry.program, entry.frag_shader);
+			glLinkProgram(entry.program);
+		}
+	}
+
+	// Finally collect results in whatever order the driver finishes them
+	unsigned int numRemaining = 0;
+	for (const Entry &entry : entries)
+	{
+		numRemaining += entry.done ? 0 : 1;
+	}
+
+	while (numRemaining > 0)
+	{
+		unsigned int numFinished = 0;
+		for (Entry &entry : entries)
+		{
+			if (entry.done || !is_complete(entry))
+			{
+				continue;
+			}
+
+			numLinked += finish_entry(entry) ? 1 : 0;
+			numFinished++;
+			numRemaining--;
+		}
+
+		if (numFinished == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	return numLinked;
+}
+
+void ShaderBatch::clear()
+{
+	entries.clear();
+}
+
+// Without the extension there is no way to ask without blocking, so everything counts as complete and the
+// link status query in finish_entry waits for the driver
+bool ShaderBatch::is_complete(const Entry &entry) const
+{
+	if (!GLExtensions::hasParallelShaderCompile())
+	{
+		return true;
+	}
+
+	GLint complete = GL_TRUE;
+	glGetProgramiv(entry.program, GLEXT_COMPLETION_STATUS, &complete);
+	return complete == GL_TRUE;
+}
+
+bool ShaderBatch::finish_entry(Entry &entry)
+{
+	entry.done = true;
+	entry.vertex_code.clear();
+	entry.fragment_code.clear();
+
+	if (!Shader::finish_program(entry.program, entry.vert_shader, entry.frag_shader, entry.cache_key))
+	{
+		std::cout << "Failed to build shader " << entry.vertex_path << " + " << entry.fragment_path << std::endl;
+		return false;
+	}
+
+	entry.shader->replace_program(entry.program);
+	return true;
+}
@@ -0,0 +1,42 @@
+#ifndef SHADERBATCH_H
+#define SHADERBATCH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Shader.h"
+
+// Builds many shaders at once. Every stage compile and program link is submitted before any status is queried, so
+// drivers with GL_KHR_parallel_shader_compile build them on their own threads, and results are polled with
+// GLEXT_COMPLETION_STATUS instead of blocking on each program in turn. Without the extension it still avoids the
+// stall after every glCompileShader that Shader::createFromFiles has
+class ShaderBatch
+{
+public:
+	ShaderBatch();
+	~ShaderBatch();
+
+	void add(Shader* shader, const char* vertexLocation, const char* fragmentLocation, const std::vector<std::string> &defines = std::vector<std::string>());
+	unsigned int compile();	// builds everything added since the last compile(), returns the number of shaders that linked
+	void clear();
+
+private:
+	struct Entry
+	{
+		Shader* shader;
+		std::string vertex_path, fragment_path;
+		std::vector<std::string> defines, dependencies;
+		std::string vertex_code, fragment_code;
+		GLuint program, vert_shader, frag_shader;
+		uint64_t cache_key;
+		bool done;
+	};
+
+	std::vector<Entry> entries;
+
+	bool is_complete(const Entry &entry) const;
+	bool finish_entry(Entry &entry);
+};
+
+#endif // !SHADERBATCH_H
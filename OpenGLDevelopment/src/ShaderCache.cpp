@@ -0,0 +1,161 @@
+#include "ShaderCache.h"
+
+#include <fstream>
+#include <vector>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "GLExtensions.h"
+
+namespace
+{
+	const uint32_t CACHE_MAGIC = 0x424C474F; // "OGLB"
+
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t binaryFormat;
+		uint32_t binaryLength;
+		uint32_t reserved;
+		uint64_t key;
+	};
+
+	// 64 bit FNV-1a, cheap and good enough to tell shader sources apart
+	uint64_t hash_bytes(uint64_t hash, const char* bytes, size_t length)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= (unsigned char)bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	// Mixes in the length too so "ab" + "c" and "a" + "bc" do not collide
+	uint64_t hash_string(uint64_t hash, const char* str, size_t length)
+	{
+		hash = hash_bytes(hash, str, length);
+		return hash_bytes(hash, (const char*)&length, sizeof(length));
+	}
+}
+
+ShaderCache::ShaderCache(const std::string &directory) : directory(directory)
+{
+	available = GLExtensions::hasProgramBinary();
+	if (!available)
+	{
+		std::cout << "Program binaries not supported by the driver, shader cache disabled" << std::endl;
+		return;
+	}
+
+	driver_ID = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+}
+
+ShaderCache::~ShaderCache()
+{
+
+}
+
+bool ShaderCache::isAvailable() const
+{
+	return available;
+}
+
+uint64_t ShaderCache::computeKey(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength) const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = hash_string(hash, driver_ID.data(), driver_ID.size());
+	hash = hash_string(hash, vertexCode, (size_t)vertexLength);
+	hash = hash_string(hash, fragmentCode, (size_t)fragmentLength);
+	return hash;
+}
+
+// Tries to link program from a cached binary, any failure (missing file, driver rejecting the binary) returns false
+// and the caller compiles from source as usual
+bool ShaderCache::loadProgram(uint64_t key, GLuint program)
+{
+	if (!available)
+	{
+		return false;
+	}
+
+	std::ifstream file(path_for_key(key), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	CacheHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != CACHE_MAGIC || header.key != key)
+	{
+		return false;
+	}
+
+	std::vector<char> binary(header.binaryLength);
+	if (!file.read(binary.data(), binary.size()))
+	{
+		return false;
+	}
+
+	GLExtensions::ProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+	GLint result = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	return result != 0;
+}
+
+// Writes the binary of a successfully linked program, the program must have been linked with
+// GLEXT_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void ShaderCache::storeProgram(uint64_t key, GLuint program)
+{
+	if (!available)
+	{
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GLEXT_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum binaryFormat = 0;
+	GLsizei written = 0;
+	GLExtensions::GetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+
+	CacheHeader header;
+	header.magic = CACHE_MAGIC;
+	header.binaryFormat = binaryFormat;
+	header.binaryLength = (uint32_t)written;
+	header.reserved = 0;
+	header.key = key;
+
+	std::ofstream file(path_for_key(key), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to write shader cache file: " << path_for_key(key) << std::endl;
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), written);
+}
+
+std::string ShaderCache::path_for_key(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return directory + "/" + name;
+}
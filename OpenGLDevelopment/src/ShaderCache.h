@@ -0,0 +1,30 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <string>
+#include <iostream>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// On-disk cache of linked program binaries, keyed on a hash of the shader sources and the driver identification strings
+// so a driver update or a source edit never picks up a stale binary
+class ShaderCache
+{
+public:
+	ShaderCache(const std::string &directory = "shader_cache");	// needs a current GL context
+	~ShaderCache();
+
+	bool isAvailable() const;
+	uint64_t computeKey(const GLchar* vertexCode, GLint vertexLength, const GLchar* fragmentCode, GLint fragmentLength) const;
+	bool loadProgram(uint64_t key, GLuint program);	// returns true if program was linked from the cached binary
+	void storeProgram(uint64_t key, GLuint program);
+
+private:
+	std::string directory, driver_ID;
+	bool available;
+
+	std::string path_for_key(uint64_t key) const;
+};
+
+#endif // !SHADERCACHE_H
@@ -0,0 +1,318 @@
+#include "ShaderPreprocessor.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "Shader.h"
+
+namespace
+{
+	// Returns the directive name if line is a preprocessor directive ("#  include ..." -> "include"), and where its arguments start
+	std::string directive_name(const std::string &line, size_t &argumentStart)
+	{
+		size_t pos = line.find_first_not_of(" \t");
+		if (pos == std::string::npos || line[pos] != '#')
+		{
+			return "";
+		}
+		pos = line.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos)
+		{
+			return "";
+		}
+		size_t end = line.find_first_of(" \t\"<", pos);
+		if (end == std::string::npos)
+		{
+			end = line.size();
+		}
+		argumentStart = end;
+		return line.substr(pos, end - pos);
+	}
+}
+
+ShaderPreprocessor::ShaderPreprocessor()
+{
+
+}
+
+ShaderPreprocessor::~ShaderPreprocessor()
+{
+
+}
+
+bool ShaderPreprocessor::process(const std::string &filePath, const std::vector<std::string> &defines, std::string &output, std::vector<std::string>* dependencies)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	std::string body, versionLine;
+	std::vector<std::string> files;
+	std::vector<std::string> includeStack;
+	std::unordered_set<std::string> included;
+	if (!expand(normalize_path(filePath), body, versionLine, files, includeStack, included))
+	{
+		return false;
+	}
+
+	// #version has to stay the first statement, so the permutation defines go right after it
+	output.clear();
+	output.reserve(versionLine.size() + body.size() + defines.size() * 32);
+	if (!versionLine.empty())
+	{
+		output += versionLine;
+		output += '\n';
+	}
+	for (const std::string &define : defines)
+	{
+		std::string name = define, value;
+		size_t equals = define.find('=');
+		if (equals != std::string::npos)
+		{
+			name = define.substr(0, equals);
+			value = define.substr(equals + 1);
+		}
+		output += "#define " + name + (value.empty() ? "" : " " + value) + "\n";
+	}
+	output += body;
+
+	if (dependencies)
+	{
+		dependencies->swap(files);
+	}
+	return true;
+}
+
+void ShaderPreprocessor::clearCache()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	file_cache.clear();
+}
+
+bool ShaderPreprocessor::getFileStamp(const std::string &filePath, time_t &modifiedTime, long long &size)
+{
+	struct stat fileStat;
+	if (stat(filePath.c_str(), &fileStat) != 0)
+	{
+		modifiedTime = 0;
+		size = -1;
+		return false;
+	}
+	modifiedTime = fileStat.st_mtime;
+	size = (long long)fileStat.st_size;
+	return true;
+}
+
+// Returns the cached parse of filePath, re-reading it only if it changed on disk since it was cached
+const ShaderPreprocessor::ParsedFile* ShaderPreprocessor::get_parsed_file(const std::string &filePath)
+{
+	time_t modifiedTime;
+	long long size;
+	if (!getFileStamp(filePath, modifiedTime, size))
+	{
+		file_cache.erase(filePath);
+		return NULL;
+	}
+
+	auto it = file_cache.find(filePath);
+	if (it != file_cache.end() && it->second.modified_time == modifiedTime && it->second.size == size)
+	{
+		return &it->second;
+	}
+
+	std::string source;
+	if (!Shader::readFile(filePath.c_str(), source))
+	{
+		return NULL;
+	}
+
+	ParsedFile &parsed = file_cache[filePath];
+	parsed.modified_time = modifiedTime;
+	parsed.size = size;
+	parse(source, parsed);
+	return &parsed;
+}
+
+// Appends the expanded contents of filePath to output, each file is included at most once per shader. versionLine
+// receives the root file's #version line, taken from the same read as its body so a save in between cannot split them
+bool ShaderPreprocessor::expand(const std::string &filePath, std::string &output, std::string &versionLine, std::vector<std::string> &files, std::vector<std::string> &includeStack, std::unordered_set<std::string> &included)
+{
+	const ParsedFile* parsed = get_parsed_file(filePath);
+	if (!parsed)
+	{
+		std::cout << "Error preprocessing shader: could not read " << filePath;
+		if (!includeStack.empty())
+		{
+			std::cout << " (included from " << includeStack.back() << ")";
+		}
+		std::cout << std::endl;
+		return false;
+	}
+	if (!parsed->error.empty())
+	{
+		std::cout << "Error preprocessing shader " << filePath << ": " << parsed->error << std::endl;
+		return false;
+	}
+
+	if (files.empty())
+	{
+		versionLine = parsed->version_line;
+	}
+
+	// #line source numbers index into files, so compile errors can be mapped back to the file they came from
+	std::string fileIndex = std::to_string(files.size());
+	files.push_back(filePath);
+	includeStack.push_back(filePath);
+	included.insert(filePath);
+
+	std::string directory = directory_of(filePath);
+	for (const Segment &segment : parsed->segments)
+	{
+		if (!segment.text.empty())
+		{
+			output += "#line " + std::to_string(segment.first_line) + " " + fileIndex + "\n";
+			output += segment.text;
+		}
+
+		if (segment.include_path.empty())
+		{
+			continue;
+		}
+
+		// Normalized so that "./x.glsl" or "../dir/x.glsl" compare equal to the path the file was first reached by
+		std::string includePath = normalize_path(directory + segment.include_path);
+		for (const std::string &parent : includeStack)
+		{
+			if (parent == includePath)
+			{
+				std::cout << "Error preprocessing shader: include cycle ";
+				for (const std::string &file : includeStack)
+				{
+					std::cout << file << " -> ";
+				}
+				std::cout << includePath << std::endl;
+				return false;
+			}
+		}
+
+		if (included.count(includePath) == 0 && !expand(includePath, output, versionLine, files, includeStack, included))
+		{
+			return false;
+		}
+	}
+
+	includeStack.pop_back();
+	return true;
+}
+
+// Splits source into segments at every #include, and pulls out the #version line
+void ShaderPreprocessor::parse(const std::string &source, ParsedFile &parsed)
+{
+	parsed.version_line.clear();
+	parsed.segments.clear();
+	parsed.error.clear();
+
+	Segment current;
+	current.first_line = 1;
+
+	int lineNumber = 0;
+	size_t lineStart = 0;
+	while (lineStart < source.size())
+	{
+		size_t lineEnd = source.find('\n', lineStart);
+		size_t nextLine = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+		lineNumber++;
+
+		std::string line = source.substr(lineStart, (lineEnd == std::string::npos ? source.size() : lineEnd) - lineStart);
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+
+		size_t argumentStart = 0;
+		std::string directive = directive_name(line, argumentStart);
+		if (directive == "version")
+		{
+			// Only the version of the top level file is used, versions in included files are dropped
+			parsed.version_line = line;
+			parsed.segments.push_back(current);
+			current = Segment();
+			current.first_line = lineNumber + 1;
+		}
+		else if (directive == "include")
+		{
+			size_t open = line.find_first_of("\"<", argumentStart);
+			size_t close = open == std::string::npos ? std::string::npos : line.find_first_of("\">", open + 1);
+			if (close == std::string::npos)
+			{
+				if (parsed.error.empty())
+				{
+					parsed.error = "malformed #include on line " + std::to_string(lineNumber) + ": " + line;
+				}
+			}
+			else
+			{
+				current.include_path = line.substr(open + 1, close - open - 1);
+			}
+			parsed.segments.push_back(current);
+			current = Segment();
+			current.first_line = lineNumber + 1;
+		}
+		else
+		{
+			current.text.append(source, lineStart, nextLine - lineStart);
+			if (lineEnd == std::string::npos)
+			{
+				current.text += '\n';
+			}
+		}
+
+		lineStart = nextLine;
+	}
+
+	parsed.segments.push_back(current);
+}
+
+std::string ShaderPreprocessor::directory_of(const std::string &filePath)
+{
+	size_t slash = filePath.find_last_of("/\\");
+	return slash == std::string::npos ? "" : filePath.substr(0, slash + 1);
+}
+
+// Collapses "." and ".." segments and repeated separators, so one file always ends up with the same path string
+std::string ShaderPreprocessor::normalize_path(const std::string &filePath)
+{
+	std::vector<std::string> parts;
+	size_t start = 0;
+	while (start <= filePath.size())
+	{
+		size_t end = filePath.find_first_of("/\\", start);
+		if (end == std::string::npos)
+		{
+			end = filePath.size();
+		}
+
+		std::string part = filePath.substr(start, end - start);
+		if (part == "..")
+		{
+			if (!parts.empty() && parts.back() != "..")
+			{
+				parts.pop_back();
+			}
+			else
+			{
+				parts.push_back(part); // above the starting directory, has to stay
+			}
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back(part);
+		}
+		start = end + 1;
+	}
+
+	std::string normalized = !filePath.empty() && (filePath[0] == '/' || filePath[0] == '\\') ? "/" : "";
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		normalized += (i > 0 ? "/" : "") + parts[i];
+	}
+	return normalized;
+}
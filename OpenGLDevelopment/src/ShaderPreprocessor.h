@@ -0,0 +1,55 @@
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <ctime>
+#include <iostream>
+
+// Resolves #include "file" directives in GLSL sources and injects #define permutation keys after the #version line
+// Every file is parsed once into text/include segments and cached by path, and only re-read when its time stamp or size
+// changes, so building many permutations of shaders that share headers does not touch the disk again
+class ShaderPreprocessor
+{
+public:
+	ShaderPreprocessor();
+	~ShaderPreprocessor();
+
+	// defines are "NAME" or "NAME=VALUE", dependencies receives every file that went into output (index = #line source number)
+	bool process(const std::string &filePath, const std::vector<std::string> &defines, std::string &output, std::vector<std::string>* dependencies = NULL);
+	void clearCache();
+
+	static bool getFileStamp(const std::string &filePath, time_t &modifiedTime, long long &size);
+
+private:
+	// A run of plain source lines, optionally followed by an include directive
+	struct Segment
+	{
+		int first_line;
+		std::string text;
+		std::string include_path;
+	};
+
+	struct ParsedFile
+	{
+		time_t modified_time;
+		long long size;
+		std::string version_line;
+		std::vector<Segment> segments;
+		std::string error;	// set if a directive could not be parsed, the file then fails to expand
+	};
+
+	std::unordered_map<std::string, ParsedFile> file_cache;
+	std::mutex cache_mutex;	// process() is called from both the GL thread and the shader watcher thread
+
+	const ParsedFile* get_parsed_file(const std::string &filePath);
+	bool expand(const std::string &filePath, std::string &output, std::string &versionLine, std::vector<std::string> &files, std::vector<std::string> &includeStack, std::unordered_set<std::string> &included);
+	static void parse(const std::string &source, ParsedFile &parsed);
+	static std::string directory_of(const std::string &filePath);
+	static std::string normalize_path(const std::string &filePath);
+};
+
+#endif // !SHADERPREPROCESSOR_H
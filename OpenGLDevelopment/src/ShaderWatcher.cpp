@@ -0,0 +1,148 @@
+#include "ShaderWatcher.h"
+
+#include <chrono>
+#include <algorithm>
+
+#include "CpuProfiler.h"
+#include "ShaderPreprocessor.h"
+
+ShaderWatcher::ShaderWatcher(unsigned int pollIntervalMilliseconds) : stopping(false), poll_interval(pollIntervalMilliseconds)
+{
+	watcher_thread = std::thread(&ShaderWatcher::watcher_loop, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	stopping.store(true);
+	watcher_thread.join();
+}
+
+void ShaderWatcher::watch(Shader* shader)
+{
+	if (shader->getVertexPath().empty() || shader->getFragmentPath().empty())
+	{
+		std::cout << "Error in ShaderWatcher::watch --> shader " << shader->getID() << " was not created from files" << std::endl;
+		return;
+	}
+
+	WatchedShader entry;
+	entry.shader = shader;
+	entry.vertex_path = shader->getVertexPath();
+	entry.fragment_path = shader->getFragmentPath();
+	entry.defines = shader->getDefines();
+
+	std::vector<std::string> paths = shader->getDependencies();
+	if (paths.empty())
+	{
+		paths.push_back(entry.vertex_path);
+		paths.push_back(entry.fragment_path);
+	}
+	set_watched_files(entry, paths);
+
+	std::lock_guard<std::mutex> lock(watch_mutex);
+	watched.push_back(entry);
+}
+
+void ShaderWatcher::unwatch(Shader* shader)
+{
+	std::lock_guard<std::mutex> lock(watch_mutex);
+	watched.erase(std::remove_if(watched.begin(), watched.end(), [shader](const WatchedShader &entry) { return entry.shader == shader; }), watched.end());
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [shader](const PendingReload &reload) { return reload.shader == shader; }), pending.end());
+}
+
+unsigned int ShaderWatcher::update()
+{
+	std::vector<PendingReload> reloads;
+	{
+		std::lock_guard<std::mutex> lock(watch_mutex);
+		reloads.swap(pending);
+	}
+
+	unsigned int numReloaded = 0;
+	for (const PendingReload &reload : reloads)
+	{
+		std::cout << "Reloading shader " << reload.shader->getVertexPath() << " + " << reload.shader->getFragmentPath() << std::endl;
+		if (reload.shader->reloadFromString(reload.vertexCode, reload.fragmentCode))
+		{
+			numReloaded++;
+		}
+	}
+	return numReloaded;
+}
+
+// Polls the modification stamps of every watched file, and reads the sources of changed shaders off the GL thread
+void ShaderWatcher::watcher_loop()
+{
+	CpuProfiler::setThreadName("Shader watcher");
+	while (!stopping.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(poll_interval));
+
+		std::lock_guard<std::mutex> lock(watch_mutex);
+		for (WatchedShader &entry : watched)
+		{
+			// Check every file, not just up to the first change, so all stamps are current afterwards
+			bool changed = false;
+			for (WatchedFile &file : entry.files)
+			{
+				changed = has_changed(file) || changed;
+			}
+			if (!changed)
+			{
+				continue;
+			}
+
+			CPU_PROFILE_ZONE("Preprocess changed shader");
+			PendingReload reload;
+			reload.shader = entry.shader;
+			std::vector<std::string> dependencies;
+			if (!Shader::preprocessFiles(entry.vertex_path, entry.fragment_path, entry.defines, reload.vertexCode, reload.fragmentCode, &dependencies))
+			{
+				// Probably caught a file mid save, forget the stamps so the next poll tries again
+				for (WatchedFile &file : entry.files)
+				{
+					file.modified_time = 0;
+				}
+				continue;
+			}
+
+			// The edit may have added or removed includes
+			set_watched_files(entry, dependencies);
+
+			// Replace an older reload of the same shader that the GL thread has not picked up yet
+			pending.erase(std::remove_if(pending.begin(), pending.end(), [&entry](const PendingReload &old) { return old.shader == entry.shader; }), pending.end());
+			pending.push_back(reload);
+		}
+	}
+}
+
+void ShaderWatcher::set_watched_files(WatchedShader &entry, const std::vector<std::string> &paths)
+{
+	entry.files.clear();
+	for (const std::string &path : paths)
+	{
+		WatchedFile file;
+		file.path = path;
+		ShaderPreprocessor::getFileStamp(path, file.modified_time, file.size);
+		entry.files.push_back(file);
+	}
+}
+
+bool ShaderWatcher::has_changed(WatchedFile &file)
+{
+	time_t modifiedTime;
+	long long size;
+	if (!ShaderPreprocessor::getFileStamp(file.path, modifiedTime, size))
+	{
+		return false;
+	}
+
+	if (modifiedTime == file.modified_time && size == file.size)
+	{
+		return false;
+	}
+
+	file.modified_time = modifiedTime;
+	file.size = size;
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+
+#include "Shader.h"
+
+// Watches the source files (and everything they #include) of registered shaders on a background thread and hot reloads
+// them when they change. Files are re-read and preprocessed on the watcher thread, the recompile and program swap happen
+// on the GL thread inside update()
+class ShaderWatcher
+{
+public:
+	ShaderWatcher(unsigned int pollIntervalMilliseconds = 250);
+	~ShaderWatcher();
+
+	void watch(Shader* shader);	// shader must have been created from files
+	void unwatch(Shader* shader);
+
+	// Call once per frame on the GL thread, returns the number of shaders that were successfully reloaded
+	unsigned int update();
+
+private:
+	struct WatchedFile
+	{
+		std::string path;
+		time_t modified_time;
+		long long size;
+	};
+
+	struct WatchedShader
+	{
+		Shader* shader;
+		std::string vertex_path, fragment_path;
+		std::vector<std::string> defines;
+		std::vector<WatchedFile> files;
+	};
+
+	struct PendingReload
+	{
+		Shader* shader;
+		std::string vertexCode, fragmentCode;
+	};
+
+	std::vector<WatchedShader> watched;	// guarded by watch_mutex
+	std::vector<PendingReload> pending;	// guarded by watch_mutex
+	std::mutex watch_mutex;
+
+	std::thread watcher_thread;
+	std::atomic<bool> stopping;
+	unsigned int poll_interval;
+
+	void watcher_loop();
+	static void set_watched_files(WatchedShader &entry, const std::vector<std::string> &paths);
+	static bool has_changed(WatchedFile &file);
+};
+
+#endif // !SHADERWATCHER_H
@@ -0,0 +1,256 @@
+#include "SpriteBatch.h"
+
+#include <cstring>
+
+SpriteBatch::SpriteBatch(unsigned int maxSpritesPerBatch, unsigned int batchesPerBuffer)
+{
+	// Indices are 16 bit, which caps a batch at 65536 vertices
+	max_sprites = maxSpritesPerBatch > 16384 ? 16384 : maxSpritesPerBatch;
+	buffer_vertices = max_sprites * 4 * batchesPerBuffer;
+	vertex_array = 0;
+	vertex_buffer = 0;
+	index_buffer = 0;
+	write_vertex = 0;
+	state = NULL;
+	current_program = 0;
+	current_texture = 0;
+	current_sampler = 0;
+	in_batch = false;
+	frame_stats = {};
+	total_stats = {};
+	num_frames = 0;
+
+	// 16 bytes a vertex
+	format.add(0, ATTRIBUTE_FLOAT, 2).add(1, ATTRIBUTE_HALF_FLOAT, 2).add(2, ATTRIBUTE_UNORM8, 4);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+
+}
+
+void SpriteBatch::create()
+{
+	staging.reserve(max_sprites * 4);
+
+	// Two triangles per quad, the same pattern for every quad in a batch
+	std::vector<uint16_t> indices(max_sprites * 6);
+	for (unsigned int i = 0; i < max_sprites; i++)
+	{
+		uint16_t first = (uint16_t)(i * 4);
+		indices[i * 6 + 0] = first;
+		indices[i * 6 + 1] = first + 1;
+		indices[i * 6 + 2] = first + 2;
+		indices[i * 6 + 3] = first + 2;
+		indices[i * 6 + 4] = first + 3;
+		indices[i * 6 + 5] = first;
+	}
+
+	glGenVertexArrays(1, &vertex_array);
+	glGenBuffers(1, &vertex_buffer);
+	glGenBuffers(1, &index_buffer);
+
+	glBindVertexArray(vertex_array);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, buffer_vertices * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+	format.apply();
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Untextured sprites sample this, so one shader covers both
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	white_texture.createFromPixels(white, 1, 1, 4);
+}
+
+void SpriteBatch::clearBatch()
+{
+	if (vertex_array == 0)
+	{
+		std::cout << "Error in SpriteBatch::clearBatch --> vertex_array == " << vertex_array << ", (tried to clear uncreated batch)" << std::endl;
+		return;
+	}
+
+	glDeleteVertexArrays(1, &vertex_array);
+	glDeleteBuffers(1, &vertex_buffer);
+	glDeleteBuffers(1, &index_buffer);
+	white_texture.clearTexture();
+	vertex_array = 0;
+	vertex_buffer = 0;
+	index_buffer = 0;
+}
+
+void SpriteBatch::begin(GLStateCache &stateCache, Shader &shader, GLuint sampler)
+{
+	if (in_batch)
+	{
+		std::cout << "Error in SpriteBatch::begin --> begin called twice without end" << std::endl;
+		return;
+	}
+
+	state = &stateCache;
+	current_program = shader.getID();
+	current_texture = white_texture.getID();
+	current_sampler = sampler;
+	frame_stats = {};
+	in_batch = true;
+}
+
+void SpriteBatch::setShader(Shader &shader)
+{
+	if (shader.getID() != current_program)
+	{
+		flush(SHADER_BREAK);
+		current_program = shader.getID();
+	}
+}
+
+void SpriteBatch::draw(const Texture &texture, float x, float y, float width, float height, const unsigned char color[4])
+{
+	static const float fullUV[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	static const unsigned char white[4] = { 255, 255, 255, 255 };
+	draw(texture.getID(), x, y, width, height, fullUV, color ? color : white);
+}
+
+// uv is left, top, right, bottom
+void SpriteBatch::draw(GLuint texture, float x, float y, float width, float height, const float uv[4], const unsigned char color[4])
+{
+	if (!in_batch)
+	{
+		std::cout << "Error in SpriteBatch::draw --> draw called outside of begin/end" << std::endl;
+		return;
+	}
+
+	if (texture == 0)
+	{
+		texture = white_texture.getID();
+	}
+	if (texture != current_texture)
+	{
+		flush(TEXTURE_BREAK);
+		current_texture = texture;
+	}
+	else if (staging.size() >= max_sprites * 4)
+	{
+		flush(FULL_BREAK);
+	}
+
+	uint16_t halfUV[4];
+	VertexPacking::floatToHalf(uv, halfUV, 4);
+	const float corners[4][2] = {
+		{ x,         y },			// top left
+		{ x,         y + height },	// bottom left
+		{ x + width, y + height },	// bottom right
+		{ x + width, y }			// top right
+	};
+	const int cornerUV[4][2] = { { 0, 1 }, { 0, 3 }, { 2, 3 }, { 2, 1 } };
+	for (int i = 0; i < 4; i++)
+	{
+		SpriteVertex vertex;
+		vertex.position[0] = corners[i][0];
+		vertex.position[1] = corners[i][1];
+		vertex.uv[0] = halfUV[cornerUV[i][0]];
+		vertex.uv[1] = halfUV[cornerUV[i][1]];
+		memcpy(vertex.color, color, 4);
+		staging.push_back(vertex);
+	}
+	frame_stats.num_sprites++;
+}
+
+void SpriteBatch::end()
+{
+	if (!in_batch)
+	{
+		std::cout << "Error in SpriteBatch::end --> end called without begin" << std::endl;
+		return;
+	}
+
+	flush(END_BREAK);
+	state->setBlend(false);
+	in_batch = false;
+	state = NULL;
+
+	add_stats(total_stats, frame_stats);
+	num_frames++;
+}
+
+const SpriteBatchStats &SpriteBatch::getStats() const
+{
+	return frame_stats;
+}
+
+const SpriteBatchStats &SpriteBatch::getTotalStats() const
+{
+	return total_stats;
+}
+
+unsigned int SpriteBatch::getNumFrames() const
+{
+	return num_frames;
+}
+
+void SpriteBatch::flush(BreakReason reason)
+{
+	if (staging.empty())
+	{
+		return;
+	}
+
+	switch (reason)
+	{
+	case TEXTURE_BREAK: frame_stats.texture_breaks++; break;
+	case SHADER_BREAK: frame_stats.shader_breaks++; break;
+	case FULL_BREAK: frame_stats.full_breaks++; break;
+	default: break;
+	}
+
+	unsigned int numVertices = (unsigned int)staging.size();
+	GLsizeiptr size = numVertices * sizeof(SpriteVertex);
+
+	state->bindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	if (write_vertex + numVertices > buffer_vertices)
+	{
+		// Out of room, hand the old storage to the driver (it stays alive until pending draws are done with it)
+		glBufferData(GL_ARRAY_BUFFER, buffer_vertices * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+		write_vertex = 0;
+		frame_stats.num_orphans++;
+	}
+
+	// Nothing in flight can be reading this range, it has not been written since the buffer was last orphaned
+	void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, write_vertex * sizeof(SpriteVertex), size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!mapped)
+	{
+		std::cout << "Error in SpriteBatch --> failed to map vertex buffer " << vertex_buffer << std::endl;
+		staging.clear();
+		return;
+	}
+	memcpy(mapped, staging.data(), size);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	state->useProgram(current_program);
+	state->bindVertexArray(vertex_array);
+	state->bindTexture(0, GL_TEXTURE_2D, current_texture);
+	state->bindSampler(0, current_sampler);
+	state->setBlend(true);
+	state->setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(numVertices / 4 * 6), GL_UNSIGNED_SHORT, 0, (GLint)write_vertex);
+
+	write_vertex += numVertices;
+	frame_stats.num_draw_calls++;
+	frame_stats.bytes_streamed += size;
+	staging.clear();
+}
+
+void SpriteBatch::add_stats(SpriteBatchStats &total, const SpriteBatchStats &frame)
+{
+	total.num_sprites += frame.num_sprites;
+	total.num_draw_calls += frame.num_draw_calls;
+	total.texture_breaks += frame.texture_breaks;
+	total.shader_breaks += frame.shader_breaks;
+	total.full_breaks += frame.full_breaks;
+	total.num_orphans += frame.num_orphans;
+	total.bytes_streamed += frame.bytes_streamed;
+}
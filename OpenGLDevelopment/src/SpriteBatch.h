@@ -0,0 +1,78 @@
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "VertexFormat.h"
+
+struct SpriteVertex
+{
+	float position[2];	// pixels, origin in the top left corner
+	uint16_t uv[2];	// half floats
+	unsigned char color[4];
+};
+
+struct SpriteBatchStats
+{
+	unsigned int num_sprites;
+	unsigned int num_draw_calls;
+	unsigned int texture_breaks;	// batches ended by a texture change
+	unsigned int shader_breaks;		// batches ended by a shader change
+	unsigned int full_breaks;		// batches ended because the staging array was full
+	unsigned int num_orphans;		// times the streaming buffer wrapped around and was orphaned
+	unsigned long long bytes_streamed;
+};
+
+// Collects screen space quads (UI, HUD, debug overlays) into a CPU staging array and draws them in as few calls as
+// possible. A batch only ends when the texture or shader changes, or the staging array fills up. Each batch is appended
+// to a streaming vertex buffer through an unsynchronized mapped range; once the buffer is full it is orphaned and
+// writing starts over at the front, so the CPU never waits on a draw that is still reading the old contents.
+// Indices never change, they are built once and every batch picks its vertices with a base vertex
+class SpriteBatch
+{
+public:
+	SpriteBatch(unsigned int maxSpritesPerBatch = 4096, unsigned int batchesPerBuffer = 8);
+	~SpriteBatch();
+
+	void create();
+	void clearBatch();
+
+	void begin(GLStateCache &state, Shader &shader, GLuint sampler = 0);	// sampler is used for every sprite until end()
+	void setShader(Shader &shader);
+	void draw(const Texture &texture, float x, float y, float width, float height, const unsigned char color[4] = NULL);
+	void draw(GLuint texture, float x, float y, float width, float height, const float uv[4], const unsigned char color[4]);	// texture 0 draws a solid color
+	void end();
+
+	const SpriteBatchStats &getStats() const;		// for the last begin()/end() pair
+	const SpriteBatchStats &getTotalStats() const;	// since creation
+	unsigned int getNumFrames() const;
+
+private:
+	enum BreakReason { TEXTURE_BREAK, SHADER_BREAK, FULL_BREAK, END_BREAK };
+
+	unsigned int max_sprites, buffer_vertices;
+	VertexFormat format;
+	GLuint vertex_array, vertex_buffer, index_buffer;
+	Texture white_texture;
+
+	std::vector<SpriteVertex> staging;
+	unsigned int write_vertex;	// next free vertex in the streaming buffer
+	GLStateCache* state;
+	GLuint current_program, current_texture, current_sampler;
+	bool in_batch;
+
+	SpriteBatchStats frame_stats, total_stats;
+	unsigned int num_frames;
+
+	void flush(BreakReason reason);
+	static void add_stats(SpriteBatchStats &total, const SpriteBatchStats &frame);
+};
+
+#endif // !SPRITEBATCH_H
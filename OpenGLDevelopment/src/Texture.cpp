@@ -1,17 +1,29 @@
 #include "Texture.h"
 
+#include <algorithm>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 
 Texture::Texture()
 {
-	
+	texture_ID = 0;
+	width = 0;
+	height = 0;
+	num_channels = 0;
+	memory_usage = 0;
+	data = NULL;
 }
 
-Texture(std::string filePath, int* width, int* height, int* nrChannels)
+// Blocking load, decodes the image on the calling thread. Use TextureLoader to stream textures without stalling frames
+Texture::Texture(std::string filePath, int* width, int* height, int* nrChannels) : Texture()
 {
-	// Load texture
+	loadFromFile(filePath);
+
+	if (width) *width = this->width;
+	if (height) *height = this->height;
+	if (nrChannels) *nrChannels = this->num_channels;
 }
 
 
@@ -20,6 +32,238 @@ Texture::~Texture()
 	
 }
 
+// Decodes the image at filePath with stb_image and uploads it, returns false if the image could not be decoded
+// Texture files (.oglt) are mapped and uploaded as they are instead
+bool Texture::loadFromFile(const std::string &filePath)
+{
+	if (TextureFile::isTextureFile(filePath))
+	{
+		TextureFile file;
+		if (!file.open(filePath))
+		{
+			return false;
+		}
+		createFromFile(file);
+		return true;
+	}
+
+	int w = 0, h = 0, channels = 0;
+	data = stbi_load(filePath.c_str(), &w, &h, &channels, 0);
+	if (!data)
+	{
+		std::cout << "Failed to load texture: " << filePath << " (" << stbi_failure_reason() << ")" << std::endl;
+		return false;
+	}
+
+	createFromPixels(data, w, h, channels);
+
+	// The pixels live on the GPU now, no need to keep the decoded copy around
+	stbi_image_free(data);
+	data = NULL;
+	return true;
+}
+
+// Creates the GL texture object (if needed) and uploads tightly packed 8 bit pixels with 1-4 channels
+// If a GL_PIXEL_UNPACK_BUFFER is bound, pixels is an offset into that buffer instead (see PixelBufferRing)
+void Texture::createFromPixels(const unsigned char* pixels, int width, int height, int numChannels)
+{
+	upload_base_level(pixels, width, height, numChannels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	memory_usage = estimateMemory(width, height, numChannels, MipGenerator::countLevels(width, height));
+}
+
+// Same as createFromPixels, but with a mip chain built on the CPU (see MipGenerator) instead of glGenerateMipmap
+// Level 0 of the chain is pixels and level i is mips[i - 1]
+void Texture::createWithMips(const unsigned char* pixels, int width, int height, int numChannels, const std::vector<MipLevel> &mips, unsigned int firstLevel)
+{
+	firstLevel = std::min(firstLevel, (unsigned int)mips.size());
+	if (firstLevel > 0)
+	{
+		pixels = mips[firstLevel - 1].pixels.data();
+		width = mips[firstLevel - 1].width;
+		height = mips[firstLevel - 1].height;
+	}
+	upload_base_level(pixels, width, height, numChannels);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = firstLevel; i < mips.size(); i++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, (GLint)(i + 1 - firstLevel), internalFormatForChannels(numChannels), mips[i].width, mips[i].height, 0,
+			formatForChannels(numChannels), GL_UNSIGNED_BYTE, mips[i].pixels.data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// A partial chain is still complete as long as sampling stops at its last level
+	unsigned int numLevels = (unsigned int)mips.size() - firstLevel + 1;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)numLevels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	memory_usage = estimateMemory(width, height, numChannels, numLevels);
+}
+
+// Same as createWithMips, but level i + 1 follows level i in memory and every level is half the size of the one before
+// (rounded down, at least 1). Like createFromPixels, pixels is an offset into a bound GL_PIXEL_UNPACK_BUFFER if there is one
+void Texture::createFromPackedLevels(const unsigned char* pixels, int width, int height, int numChannels, unsigned int numLevels)
+{
+	if (numLevels <= 1)
+	{
+		createFromPixels(pixels, width, height, numChannels);
+		return;
+	}
+	upload_base_level(pixels, width, height, numChannels);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	size_t offset = (size_t)width * height * numChannels;
+	for (unsigned int level = 1; level < numLevels; level++)
+	{
+		int levelWidth = std::max(width >> level, 1), levelHeight = std::max(height >> level, 1);
+		glTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormatForChannels(numChannels), levelWidth, levelHeight, 0,
+			formatForChannels(numChannels), GL_UNSIGNED_BYTE, pixels + offset);
+		offset += (size_t)levelWidth * levelHeight * numChannels;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)numLevels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	memory_usage = estimateMemory(width, height, numChannels, numLevels);
+}
+
+// Uploads block compressed levels (see BlockCompressor) as they are, the texture keeps the format's channel count
+void Texture::createCompressed(BlockFormat format, const std::vector<CompressedLevel> &levels, unsigned int firstLevel)
+{
+	if (levels.empty())
+	{
+		std::cout << "Error in Texture::createCompressed --> no levels to upload" << std::endl;
+		return;
+	}
+	if (texture_ID == 0)
+	{
+		glGenTextures(1, &texture_ID);
+	}
+
+	firstLevel = std::min(firstLevel, (unsigned int)levels.size() - 1);
+	this->width = levels[firstLevel].width;
+	this->height = levels[firstLevel].height;
+	this->num_channels = BlockCompressor::channelsForFormat(format);
+
+	glBindTexture(GL_TEXTURE_2D, texture_ID);
+
+	memory_usage = 0;
+	for (size_t i = firstLevel; i < levels.size(); i++)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)(i - firstLevel), BlockCompressor::glFormat(format), levels[i].width, levels[i].height, 0,
+			(GLsizei)levels[i].blocks.size(), levels[i].blocks.data());
+		memory_usage += levels[i].blocks.size();
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)(levels.size() - firstLevel) - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Uploads every level of an open texture file straight out of the mapping, they are already in the layout GL expects
+void Texture::createFromFile(const TextureFile &file, unsigned int firstLevel)
+{
+	if (!file.isOpen())
+	{
+		std::cout << "Error in Texture::createFromFile --> the texture file is not open" << std::endl;
+		return;
+	}
+	if (file.isCompressed() && !BlockCompressor::isSupported(file.getBlockFormat()))
+	{
+		std::cout << "Error in Texture::createFromFile --> the driver does not support the file's block format" << std::endl;
+		return;
+	}
+	if (texture_ID == 0)
+	{
+		glGenTextures(1, &texture_ID);
+	}
+
+	firstLevel = std::min(firstLevel, file.getNumLevels() - 1);
+	const unsigned int numLevels = file.getNumLevels() - firstLevel;
+	this->width = file.getLevel(firstLevel).width;
+	this->height = file.getLevel(firstLevel).height;
+	this->num_channels = file.getNumChannels();
+
+	glBindTexture(GL_TEXTURE_2D, texture_ID);
+
+	memory_usage = 0;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (unsigned int i = 0; i < numLevels; i++)
+	{
+		TextureFileLevel level = file.getLevel(firstLevel + i);
+		if (file.isCompressed())
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, BlockCompressor::glFormat(file.getBlockFormat()), level.width, level.height, 0,
+				(GLsizei)level.size, level.data);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormatForChannels(num_channels), level.width, level.height, 0,
+				formatForChannels(num_channels), GL_UNSIGNED_BYTE, level.data);
+		}
+		memory_usage += level.size;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)numLevels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Leaves the texture bound to GL_TEXTURE_2D for the caller to fill in the mip levels
+void Texture::upload_base_level(const unsigned char* pixels, int width, int height, int numChannels)
+{
+	if (texture_ID == 0)
+	{
+		glGenTextures(1, &texture_ID);
+	}
+
+	this->width = width;
+	this->height = height;
+	this->num_channels = numChannels;
+
+	glBindTexture(GL_TEXTURE_2D, texture_ID);
+
+	// stb_image rows are tightly packed, which breaks the default 4 byte row alignment for RGB and single channel images
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormatForChannels(numChannels), width, height, 0, formatForChannels(numChannels), GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+}
+
+// Replaces the contents of the texture with pixels of the same size and channel count
+void Texture::updatePixels(const unsigned char* pixels)
+{
+	glBindTexture(GL_TEXTURE_2D, texture_ID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, formatForChannels(num_channels), GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture::bind(GLuint unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, texture_ID);
+}
+
+void Texture::clearTexture()
+{
+	if (texture_ID == 0)
+	{
+		std::cout << "Error in Texture::clearTexture --> texture_ID == " << texture_ID << ", (tried to clear unallocated texture)" << std::endl;
+	}
+	else
+	{
+		glDeleteTextures(1, &texture_ID);
+		texture_ID = 0;
+	}
+
+	width = 0;
+	height = 0;
+	num_channels = 0;
+	memory_usage = 0;
+}
+
 GLuint Texture::getID() const
 {
 	return texture_ID;
@@ -38,4 +282,42 @@ GLuint Texture::getHeight() const
 GLuint Texture::getNumChannels() const
 {
 	return num_channels;
-}
\ No newline at end of file
+}
+
+size_t Texture::getMemoryUsage() const
+{
+	return memory_usage;
+}
+
+GLenum Texture::formatForChannels(int numChannels)
+{
+	switch (numChannels)
+	{
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+GLenum Texture::internalFormatForChannels(int numChannels)
+{
+	switch (numChannels)
+	{
+	case 1: return GL_R8;
+	case 2: return GL_RG8;
+	case 3: return GL_RGB8;
+	default: return GL_RGBA8;
+	}
+}
+
+// Drivers may pad RGB to 4 bytes per texel, so treat this as a lower bound for 3 channel textures
+size_t Texture::estimateMemory(int width, int height, int numChannels, unsigned int numLevels)
+{
+	size_t total = 0;
+	for (unsigned int level = 0; level < numLevels; level++)
+	{
+		total += (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * numChannels;
+	}
+	return total;
+}
@@ -3,14 +3,24 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
-#include <glad\glad.h>
+#include <glad/glad.h>
 
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+#include "TextureFile.h"
+
+// Only the image and its level range live in the texture, filtering and wrapping come from the sampler bound to the
+// same unit (see SamplerCache)
 class Texture
 {
 private:
 	GLuint texture_ID;
 	int width, height, num_channels;
+	size_t memory_usage;
+
+	void upload_base_level(const unsigned char* pixels, int width, int height, int numChannels);
 
 public:
 	unsigned char* data;
@@ -19,11 +29,28 @@ public:
 	Texture(std::string filePath, int* width, int* height, int* nrChannels);
 	~Texture();
 
-	GLuint Texture::getID() const;
-	GLuint Texture::getWidth() const;
-	GLuint Texture::getHeight() const;
-	GLuint Texture::getNumChannels() const;
+	bool loadFromFile(const std::string &filePath);
+	void createFromPixels(const unsigned char* pixels, int width, int height, int numChannels);
+	// firstLevel leaves that many of the largest levels out, e.g. to fit a memory budget (see TextureCache)
+	void createWithMips(const unsigned char* pixels, int width, int height, int numChannels, const std::vector<MipLevel> &mips, unsigned int firstLevel = 0);
+	// Levels packed back to back, largest first, numLevels == 1 builds the rest with glGenerateMipmap (see PixelBufferRing)
+	void createFromPackedLevels(const unsigned char* pixels, int width, int height, int numChannels, unsigned int numLevels);
+	void createCompressed(BlockFormat format, const std::vector<CompressedLevel> &levels, unsigned int firstLevel = 0);	// levels[0] is the base level
+	void createFromFile(const TextureFile &file, unsigned int firstLevel = 0);
+	void updatePixels(const unsigned char* pixels);
+	void bind(GLuint unit = 0) const;
+	void clearTexture();
+
+	GLuint getID() const;
+	GLuint getWidth() const;
+	GLuint getHeight() const;
+	GLuint getNumChannels() const;
+	size_t getMemoryUsage() const;	// estimated bytes of video memory, all levels included
+
+	static GLenum formatForChannels(int numChannels);
+	static GLenum internalFormatForChannels(int numChannels);
+	static size_t estimateMemory(int width, int height, int numChannels, unsigned int numLevels);	// uncompressed 8 bit levels
 };
 
 
-#endif // !TEXTURE_H
\ No newline at end of file
+#endif // !TEXTURE_H
@@ -0,0 +1,183 @@
+#include "TextureArray.h"
+
+#include "stb_image.h"
+#include "Texture.h"
+
+TextureArray::TextureArray()
+{
+	texture_ID = 0;
+	width = 0;
+	height = 0;
+	num_channels = 0;
+	num_layers = 0;
+	num_levels = 0;
+}
+
+TextureArray::~TextureArray()
+{
+
+}
+
+// GL 3.3 has no immutable storage, so every level is specified once here with no data and filled in by setLayer
+void TextureArray::create(int width, int height, int numChannels, int numLayers)
+{
+	if (texture_ID == 0)
+	{
+		glGenTextures(1, &texture_ID);
+	}
+
+	this->width = width;
+	this->height = height;
+	this->num_channels = numChannels;
+	this->num_layers = numLayers;
+	this->num_levels = MipGenerator::countLevels(width, height);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_ID);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+
+	for (int level = 0; level < num_levels; level++)
+	{
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, Texture::internalFormatForChannels(numChannels), std::max(width >> level, 1),
+			std::max(height >> level, 1), numLayers, 0, Texture::formatForChannels(numChannels), GL_UNSIGNED_BYTE, NULL);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::setLayer(int layer, const unsigned char* pixels)
+{
+	setLayer(layer, pixels, std::vector<MipLevel>());
+}
+
+void TextureArray::setLayer(int layer, const unsigned char* pixels, const std::vector<MipLevel> &mips)
+{
+	if (layer < 0 || layer >= num_layers)
+	{
+		std::cout << "Error in TextureArray::setLayer --> layer " << layer << " is out of range (" << num_layers << " layers)" << std::endl;
+		return;
+	}
+
+	const GLenum format = Texture::formatForChannels(num_channels);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_ID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, pixels);
+	for (size_t i = 0; i < mips.size() && (int)i + 1 < num_levels; i++)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i + 1, 0, 0, layer, mips[i].width, mips[i].height, 1, format, GL_UNSIGNED_BYTE, mips[i].pixels.data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::generateMipmaps()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_ID);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// The first file decides the size and channel count, the rest are decoded to the same channel count and must match in size
+bool TextureArray::loadFromFiles(const std::vector<std::string> &filePaths, MipGenerator* mipGenerator)
+{
+	if (filePaths.empty())
+	{
+		std::cout << "Error in TextureArray::loadFromFiles --> no files to load" << std::endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < filePaths.size(); i++)
+	{
+		int w = 0, h = 0, channels = 0;
+		unsigned char* pixels = stbi_load(filePaths[i].c_str(), &w, &h, &channels, i == 0 ? 0 : num_channels);
+		if (!pixels)
+		{
+			std::cout << "Failed to load texture: " << filePaths[i] << " (" << stbi_failure_reason() << ")" << std::endl;
+			return false;
+		}
+
+		if (i == 0)
+		{
+			create(w, h, channels, (int)filePaths.size());
+		}
+		else if (w != width || h != height)
+		{
+			std::cout << "Error in TextureArray::loadFromFiles --> " << filePaths[i] << " is " << w << "x" << h << ", the array is "
+				<< width << "x" << height << std::endl;
+			stbi_image_free(pixels);
+			return false;
+		}
+
+		if (mipGenerator)
+		{
+			std::vector<MipLevel> mips;
+			mipGenerator->generate(pixels, width, height, num_channels, num_channels >= 3, mips);
+			setLayer((int)i, pixels, mips);
+		}
+		else
+		{
+			setLayer((int)i, pixels);
+		}
+		stbi_image_free(pixels);
+	}
+
+	if (!mipGenerator)
+	{
+		generateMipmaps();
+	}
+	return true;
+}
+
+void TextureArray::bind(GLuint unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_ID);
+}
+
+void TextureArray::clearTexture()
+{
+	if (texture_ID == 0)
+	{
+		std::cout << "Error in TextureArray::clearTexture --> texture_ID == " << texture_ID << ", (tried to clear unallocated texture)" << std::endl;
+	}
+	else
+	{
+		glDeleteTextures(1, &texture_ID);
+		texture_ID = 0;
+	}
+
+	width = 0;
+	height = 0;
+	num_channels = 0;
+	num_layers = 0;
+	num_levels = 0;
+}
+
+GLuint TextureArray::getID() const
+{
+	return texture_ID;
+}
+
+int TextureArray::getWidth() const
+{
+	return width;
+}
+
+int TextureArray::getHeight() const
+{
+	return height;
+}
+
+int TextureArray::getNumChannels() const
+{
+	return num_channels;
+}
+
+int TextureArray::getNumLayers() const
+{
+	return num_layers;
+}
+
+// Estimated, see Texture::getMemoryUsage
+size_t TextureArray::getMemoryUsage() const
+{
+	return Texture::estimateMemory(width, height, num_channels, num_levels) * num_layers;
+}
@@ -0,0 +1,41 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "MipGenerator.h"
+
+// Many same sized images in a single GL_TEXTURE_2D_ARRAY. Shaders pick an image with a layer index that comes from
+// vertex or instance data (see shaders/instanced.vert), so objects that only differ in their texture no longer need a
+// bind each, and with instancing or batching they can share one draw call. Sample it through a SamplerCache sampler
+class TextureArray
+{
+public:
+	TextureArray();
+	~TextureArray();
+
+	void create(int width, int height, int numChannels, int numLayers);	// allocates every layer and mip level
+	void setLayer(int layer, const unsigned char* pixels);	// tightly packed, call generateMipmaps once all layers are in
+	void setLayer(int layer, const unsigned char* pixels, const std::vector<MipLevel> &mips);	// with a CPU built chain
+	void generateMipmaps();
+	bool loadFromFiles(const std::vector<std::string> &filePaths, MipGenerator* mipGenerator = NULL);	// one layer per file
+	void bind(GLuint unit = 0) const;
+	void clearTexture();
+
+	GLuint getID() const;
+	int getWidth() const;
+	int getHeight() const;
+	int getNumChannels() const;
+	int getNumLayers() const;
+	size_t getMemoryUsage() const;
+
+private:
+	GLuint texture_ID;
+	int width, height, num_channels, num_layers, num_levels;
+};
+
+#endif // !TEXTUREARRAY_H
@@ -0,0 +1,387 @@
+#include "TextureAtlas.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "stb_image.h"
+#include "MaxRectsPacker.h"
+
+namespace
+{
+	const uint32_t ATLAS_MAGIC = 0x414C474F;	// "OGLA"
+	const uint32_t ATLAS_VERSION = 1;
+
+	struct AtlasHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		int32_t page_size;
+		uint32_t num_pages;
+		uint32_t num_regions;
+		uint32_t reserved;
+	};
+
+	struct CachedRegion
+	{
+		uint32_t page;
+		int32_t x, y, width, height;
+	};
+
+	// 64 bit FNV-1a
+	uint64_t hash_bytes(uint64_t hash, const void* data, size_t length)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	uint64_t hash_string(uint64_t hash, const std::string &str)
+	{
+		size_t length = str.size();
+		hash = hash_bytes(hash, str.data(), length);
+		return hash_bytes(hash, &length, sizeof(length));
+	}
+
+	int align_up(int value, int alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+TextureAtlas::TextureAtlas(int pageSize, int gutterSize)
+{
+	page_size = pageSize;
+	gutter = gutterSize;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+
+}
+
+void TextureAtlas::addImage(const std::string &name, const std::string &filePath)
+{
+	Source source;
+	source.name = name;
+	source.file_path = filePath;
+	source.width = 0;
+	source.height = 0;
+	sources.push_back(source);
+}
+
+void TextureAtlas::addPixels(const std::string &name, const unsigned char* rgbaPixels, int width, int height)
+{
+	Source source;
+	source.name = name;
+	source.pixels.assign(rgbaPixels, rgbaPixels + (size_t)width * height * 4);
+	source.width = width;
+	source.height = height;
+	sources.push_back(source);
+}
+
+bool TextureAtlas::build(const std::string &cachePath)
+{
+	std::vector<std::vector<unsigned char>> pagePixels;
+	uint64_t key = compute_cache_key();
+	regions.clear();
+
+	if (cachePath.empty() || !load_cache(cachePath, key, pagePixels))
+	{
+		if (!pack(pagePixels))
+		{
+			return false;
+		}
+		if (!cachePath.empty())
+		{
+			save_cache(cachePath, key, pagePixels);
+		}
+	}
+
+	// Full mip chains, the gutters are what keep them clean
+	pages.resize(pagePixels.size());
+	for (size_t i = 0; i < pagePixels.size(); i++)
+	{
+		pages[i].createFromPixels(pagePixels[i].data(), page_size, page_size, 4);
+	}
+
+	// Decoded files are in the pages now, they are decoded again if the atlas is ever rebuilt
+	for (Source &source : sources)
+	{
+		if (!source.file_path.empty())
+		{
+			std::vector<unsigned char>().swap(source.pixels);
+		}
+	}
+	return true;
+}
+
+void TextureAtlas::clearAtlas()
+{
+	for (Texture &page : pages)
+	{
+		page.clearTexture();
+	}
+	pages.clear();
+	regions.clear();
+	sources.clear();
+}
+
+const AtlasRegion* TextureAtlas::find(const std::string &name) const
+{
+	auto it = regions.find(name);
+	return it != regions.end() ? &it->second : NULL;
+}
+
+const std::unordered_map<std::string, AtlasRegion>& TextureAtlas::getRegions() const
+{
+	return regions;
+}
+
+const Texture& TextureAtlas::getPage(unsigned int page) const
+{
+	return pages[page];
+}
+
+unsigned int TextureAtlas::getNumPages() const
+{
+	return (unsigned int)pages.size();
+}
+
+// Covers everything that changes the output: the layout settings, every image's name, and its file stamp (or its
+// pixels, for images that were not loaded from a file)
+uint64_t TextureAtlas::compute_cache_key() const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = hash_bytes(hash, &page_size, sizeof(page_size));
+	hash = hash_bytes(hash, &gutter, sizeof(gutter));
+	for (const Source &source : sources)
+	{
+		hash = hash_string(hash, source.name);
+		if (source.file_path.empty())
+		{
+			hash = hash_bytes(hash, &source.width, sizeof(source.width));
+			hash = hash_bytes(hash, &source.height, sizeof(source.height));
+			hash = hash_bytes(hash, source.pixels.data(), source.pixels.size());
+			continue;
+		}
+
+		hash = hash_string(hash, source.file_path);
+		struct stat fileStat;
+		if (stat(source.file_path.c_str(), &fileStat) == 0)
+		{
+			long long modifiedTime = (long long)fileStat.st_mtime, size = (long long)fileStat.st_size;
+			hash = hash_bytes(hash, &modifiedTime, sizeof(modifiedTime));
+			hash = hash_bytes(hash, &size, sizeof(size));
+		}
+	}
+	return hash;
+}
+
+bool TextureAtlas::pack(std::vector<std::vector<unsigned char>> &pagePixels)
+{
+	// Decode whatever was added by path
+	for (Source &source : sources)
+	{
+		if (source.file_path.empty())
+		{
+			continue;
+		}
+		int channels = 0;
+		unsigned char* pixels = stbi_load(source.file_path.c_str(), &source.width, &source.height, &channels, 4);
+		if (!pixels)
+		{
+			std::cout << "Failed to load atlas image: " << source.file_path << " (" << stbi_failure_reason() << ")" << std::endl;
+			return false;
+		}
+		source.pixels.assign(pixels, pixels + (size_t)source.width * source.height * 4);
+		stbi_image_free(pixels);
+	}
+
+	// Biggest first packs tighter
+	std::vector<size_t> order(sources.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+	{
+		const Source &first = sources[a], &second = sources[b];
+		int firstMax = std::max(first.width, first.height), secondMax = std::max(second.width, second.height);
+		return firstMax != secondMax ? firstMax > secondMax : first.width * first.height > second.width * second.height;
+	});
+
+	std::vector<MaxRectsPacker> packers;
+	for (size_t index : order)
+	{
+		const Source &source = sources[index];
+		int paddedWidth = align_up(source.width + gutter * 2, 4), paddedHeight = align_up(source.height + gutter * 2, 4);
+		if (paddedWidth > page_size || paddedHeight > page_size)
+		{
+			std::cout << "Error in TextureAtlas::build --> " << source.name << " (" << source.width << "x" << source.height << ") does not fit into a " << page_size << " page" << std::endl;
+			return false;
+		}
+
+		// First page with room, or a new one
+		PackedRect placed;
+		size_t page = 0;
+		while (page < packers.size() && !packers[page].insert(paddedWidth, paddedHeight, placed))
+		{
+			page++;
+		}
+		if (page == packers.size())
+		{
+			packers.push_back(MaxRectsPacker(page_size, page_size));
+			pagePixels.push_back(std::vector<unsigned char>((size_t)page_size * page_size * 4, 0));
+			packers.back().insert(paddedWidth, paddedHeight, placed);
+		}
+
+		blit(source, pagePixels[page], placed.x, placed.y);
+
+		AtlasRegion region;
+		region.page = (unsigned int)page;
+		region.x = placed.x + gutter;
+		region.y = placed.y + gutter;
+		region.width = source.width;
+		region.height = source.height;
+		set_uvs(region);
+		regions[source.name] = region;
+	}
+
+	for (size_t i = 0; i < packers.size(); i++)
+	{
+		std::cout << "Atlas page " << i << ": " << (int)(packers[i].getOccupancy() * 100.0f) << "% used" << std::endl;
+	}
+	return true;
+}
+
+// Copies the image to (x + gutter, y + gutter) and fills the gutter around it by repeating the edge pixels
+void TextureAtlas::blit(const Source &source, std::vector<unsigned char> &page, int x, int y) const
+{
+	const size_t rowBytes = (size_t)source.width * 4;
+	for (int row = -gutter; row < source.height + gutter; row++)
+	{
+		int sourceRow = std::min(std::max(row, 0), source.height - 1);
+		const unsigned char* sourcePixels = source.pixels.data() + sourceRow * rowBytes;
+		unsigned char* destination = page.data() + ((size_t)(y + gutter + row) * page_size + x) * 4;
+
+		for (int i = 0; i < gutter; i++)
+		{
+			memcpy(destination + i * 4, sourcePixels, 4);
+		}
+		memcpy(destination + gutter * 4, sourcePixels, rowBytes);
+		for (int i = 0; i < gutter; i++)
+		{
+			memcpy(destination + (gutter + source.width + i) * 4, sourcePixels + rowBytes - 4, 4);
+		}
+	}
+}
+
+bool TextureAtlas::load_cache(const std::string &cachePath, uint64_t key, std::vector<std::vector<unsigned char>> &pagePixels)
+{
+	std::ifstream file(cachePath, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	AtlasHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != ATLAS_MAGIC || header.version != ATLAS_VERSION ||
+		header.key != key || header.page_size != page_size)
+	{
+		return false;
+	}
+
+	std::unordered_map<std::string, AtlasRegion> cachedRegions;
+	for (uint32_t i = 0; i < header.num_regions; i++)
+	{
+		uint32_t nameLength = 0;
+		if (!file.read((char*)&nameLength, sizeof(nameLength)))
+		{
+			return false;
+		}
+		std::string name(nameLength, '\0');
+		CachedRegion cached;
+		if (!file.read(&name[0], nameLength) || !file.read((char*)&cached, sizeof(cached)))
+		{
+			return false;
+		}
+
+		AtlasRegion region;
+		region.page = cached.page;
+		region.x = cached.x;
+		region.y = cached.y;
+		region.width = cached.width;
+		region.height = cached.height;
+		set_uvs(region);
+		cachedRegions[name] = region;
+	}
+
+	pagePixels.assign(header.num_pages, std::vector<unsigned char>((size_t)page_size * page_size * 4));
+	for (std::vector<unsigned char> &page : pagePixels)
+	{
+		if (!file.read((char*)page.data(), page.size()))
+		{
+			pagePixels.clear();
+			return false;
+		}
+	}
+
+	regions.swap(cachedRegions);
+	return true;
+}
+
+void TextureAtlas::save_cache(const std::string &cachePath, uint64_t key, const std::vector<std::vector<unsigned char>> &pagePixels) const
+{
+	std::ofstream file(cachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to write atlas cache file: " << cachePath << std::endl;
+		return;
+	}
+
+	AtlasHeader header;
+	header.magic = ATLAS_MAGIC;
+	header.version = ATLAS_VERSION;
+	header.key = key;
+	header.page_size = page_size;
+	header.num_pages = (uint32_t)pagePixels.size();
+	header.num_regions = (uint32_t)regions.size();
+	header.reserved = 0;
+	file.write((const char*)&header, sizeof(header));
+
+	for (const auto &entry : regions)
+	{
+		uint32_t nameLength = (uint32_t)entry.first.size();
+		CachedRegion cached;
+		cached.page = entry.second.page;
+		cached.x = entry.second.x;
+		cached.y = entry.second.y;
+		cached.width = entry.second.width;
+		cached.height = entry.second.height;
+		file.write((const char*)&nameLength, sizeof(nameLength));
+		file.write(entry.first.data(), nameLength);
+		file.write((const char*)&cached, sizeof(cached));
+	}
+
+	for (const std::vector<unsigned char> &page : pagePixels)
+	{
+		file.write((const char*)page.data(), page.size());
+	}
+}
+
+void TextureAtlas::set_uvs(AtlasRegion &region) const
+{
+	const float scale = 1.0f / page_size;
+	region.uv[0] = region.x * scale;
+	region.uv[1] = region.y * scale;
+	region.uv[2] = (region.x + region.width) * scale;
+	region.uv[3] = (region.y + region.height) * scale;
+}
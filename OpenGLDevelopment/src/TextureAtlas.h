@@ -0,0 +1,63 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "Texture.h"
+
+struct AtlasRegion
+{
+	unsigned int page;
+	float uv[4];	// left, top, right, bottom
+	int x, y, width, height;	// pixels inside the page, gutters excluded
+};
+
+// Packs many small images into a few large RGBA pages so sprites that use different images can still share a texture
+// (and a batch). Images are placed with MaxRects, each surrounded by a gutter of repeated edge pixels so filtering and
+// the smaller mip levels do not bleed neighbours in, and every placement starts on a 4 pixel boundary.
+// The packed pages and the UV table can be cached on disk, a cache hit skips decoding and packing altogether
+class TextureAtlas
+{
+public:
+	TextureAtlas(int pageSize = 2048, int gutter = 4);
+	~TextureAtlas();
+
+	void addImage(const std::string &name, const std::string &filePath);	// decoded during build(), if the cache misses
+	void addPixels(const std::string &name, const unsigned char* rgbaPixels, int width, int height);
+	bool build(const std::string &cachePath = "");
+	void clearAtlas();
+
+	const AtlasRegion* find(const std::string &name) const;	// NULL if there is no such image
+	const std::unordered_map<std::string, AtlasRegion>& getRegions() const;
+	const Texture& getPage(unsigned int page) const;
+	unsigned int getNumPages() const;
+
+private:
+	struct Source
+	{
+		std::string name;
+		std::string file_path;				// empty for images added as pixels
+		std::vector<unsigned char> pixels;	// RGBA
+		int width, height;
+	};
+
+	int page_size, gutter;
+	std::vector<Source> sources;
+	std::unordered_map<std::string, AtlasRegion> regions;
+	std::vector<Texture> pages;
+
+	uint64_t compute_cache_key() const;
+	bool pack(std::vector<std::vector<unsigned char>> &pagePixels);
+	void blit(const Source &source, std::vector<unsigned char> &page, int x, int y) const;
+	bool load_cache(const std::string &cachePath, uint64_t key, std::vector<std::vector<unsigned char>> &pagePixels);
+	void save_cache(const std::string &cachePath, uint64_t key, const std::vector<std::vector<unsigned char>> &pagePixels) const;
+	void set_uvs(AtlasRegion &region) const;
+};
+
+#endif // !TEXTUREATLAS_H
@@ -0,0 +1,210 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+
+namespace
+{
+	const unsigned int COLD_FRAMES = 120;			// textures unused for longer than this are evicted instead of shrunk
+	const unsigned int MAX_DROPPED_LEVELS = 3;		// never go below 1/8 of the original size
+	const unsigned int MIN_DROPPED_SIZE = 64;		// or below this many pixels on the short side
+}
+
+TextureCache::TextureCache(TextureLoader &loader, size_t budgetBytes) : loader(loader)
+{
+	budget = budgetBytes;
+	resident_bytes = 0;
+	frame_number = 0;
+	num_evictions = 0;
+	num_dropped_levels = 0;
+}
+
+TextureCache::~TextureCache()
+{
+
+}
+
+unsigned int TextureCache::add(const std::string &filePath)
+{
+	Entry entry;
+	entry.file_path = filePath;
+	entry.first_level = 0;
+	entry.replacement_level = 0;
+	entry.last_used_frame = frame_number;
+	entries.push_back(entry);
+
+	unsigned int id = (unsigned int)entries.size() - 1;
+	entries.back().lru_position = lru.insert(lru.end(), id);
+	return id;
+}
+
+// Starts the load if the texture is not resident (it was never used or it has been evicted)
+const Texture* TextureCache::get(unsigned int id)
+{
+	if (id >= entries.size())
+	{
+		std::cout << "Error in TextureCache::get --> id " << id << " was never added" << std::endl;
+		return NULL;
+	}
+
+	Entry &entry = entries[id];
+	entry.last_used_frame = frame_number;
+	lru.splice(lru.begin(), lru, entry.lru_position);
+
+	if (entry.handle.isEmpty())
+	{
+		entry.handle = loader.load(entry.file_path, entry.first_level);
+	}
+	return entry.handle.isReady() ? &entry.handle.getTexture() : NULL;
+}
+
+void TextureCache::update()
+{
+	swap_in_replacements();
+
+	// Textures that are being replaced count at the size they are going to have
+	resident_bytes = 0;
+	for (const Entry &entry : entries)
+	{
+		if (entry.handle.isReady())
+		{
+			size_t bytes = entry.handle.getTexture().getMemoryUsage();
+			if (entry.replacement.isPending())
+			{
+				int shift = 2 * ((int)entry.replacement_level - (int)entry.first_level);
+				bytes = shift >= 0 ? bytes >> shift : bytes << -shift;
+			}
+			resident_bytes += bytes;
+		}
+	}
+
+	if (resident_bytes > budget)
+	{
+		enforce_budget();
+	}
+	else
+	{
+		restore_levels();
+	}
+	frame_number++;
+}
+
+void TextureCache::clearCache()
+{
+	for (Entry &entry : entries)
+	{
+		entry.handle.release();
+		entry.replacement.release();
+	}
+	entries.clear();
+	lru.clear();
+	resident_bytes = 0;
+}
+
+void TextureCache::setBudget(size_t budgetBytes)
+{
+	budget = budgetBytes;
+}
+
+size_t TextureCache::getBudget() const
+{
+	return budget;
+}
+
+// Estimated, see Texture::getMemoryUsage
+size_t TextureCache::getResidentBytes() const
+{
+	return resident_bytes;
+}
+
+unsigned int TextureCache::getNumEvictions() const
+{
+	return num_evictions;
+}
+
+unsigned int TextureCache::getNumDroppedLevels() const
+{
+	return num_dropped_levels;
+}
+
+// A texture keeps drawing at its old size until the reload has been uploaded, then the old one is deleted
+void TextureCache::swap_in_replacements()
+{
+	for (Entry &entry : entries)
+	{
+		if (entry.replacement.isEmpty() || entry.replacement.isPending())
+		{
+			continue;
+		}
+
+		if (entry.replacement.isReady())
+		{
+			entry.handle.release();
+			entry.handle = entry.replacement;
+			entry.first_level = entry.replacement_level;
+		}
+		entry.replacement = TextureHandle();
+	}
+}
+
+// Least recently used first. Textures that are still in use are only ever shrunk, if they are already as small as
+// allowed the cache stays over budget rather than pulling a texture out from under the renderer
+void TextureCache::enforce_budget()
+{
+	for (auto it = lru.rbegin(); it != lru.rend() && resident_bytes > budget; ++it)
+	{
+		Entry &entry = entries[*it];
+		if (!entry.handle.isReady() || entry.replacement.isPending())
+		{
+			continue;
+		}
+
+		const Texture &texture = entry.handle.getTexture();
+		size_t bytes = texture.getMemoryUsage();
+		bool cold = frame_number - entry.last_used_frame > COLD_FRAMES;
+		bool canShrink = entry.first_level < MAX_DROPPED_LEVELS && std::min(texture.getWidth(), texture.getHeight()) / 2 >= MIN_DROPPED_SIZE;
+
+		if (cold)
+		{
+			entry.handle.release();
+			num_evictions++;
+			resident_bytes -= bytes;
+		}
+		else if (canShrink)
+		{
+			reload(entry, entry.first_level + 1);
+			num_dropped_levels++;
+			resident_bytes -= bytes - bytes / 4;
+		}
+	}
+}
+
+// Gives one level back to the most recently used shrunk texture, if the full size version fits the budget
+void TextureCache::restore_levels()
+{
+	for (unsigned int id : lru)
+	{
+		Entry &entry = entries[id];
+		if (frame_number - entry.last_used_frame > COLD_FRAMES)
+		{
+			return;
+		}
+		if (entry.first_level == 0 || !entry.handle.isReady() || !entry.replacement.isEmpty())
+		{
+			continue;
+		}
+
+		size_t bytes = entry.handle.getTexture().getMemoryUsage();
+		if (resident_bytes - bytes + bytes * 4 <= budget)
+		{
+			reload(entry, entry.first_level - 1);
+			resident_bytes += bytes * 3;
+		}
+		return;
+	}
+}
+
+void TextureCache::reload(Entry &entry, unsigned int firstLevel)
+{
+	entry.replacement = loader.load(entry.file_path, firstLevel);
+	entry.replacement_level = firstLevel;
+}
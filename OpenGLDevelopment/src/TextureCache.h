@@ -0,0 +1,57 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <cstddef>
+
+#include "Texture.h"
+#include "TextureLoader.h"
+
+// Keeps the textures that are registered with it within a video memory budget. Textures load on first use (through
+// the TextureLoader) and each frame the cache adds up their estimated sizes. While it is over budget it goes through
+// them least recently used first: textures that have not been drawn for a while are deleted outright (and come back
+// the next time they are asked for), textures that are still in use are reloaded one mip level smaller.
+// When there is room again, recently used textures get their levels back one at a time
+class TextureCache
+{
+public:
+	TextureCache(TextureLoader &loader, size_t budgetBytes);
+	~TextureCache();
+
+	unsigned int add(const std::string &filePath);	// returns the id to get() it with, nothing is loaded yet
+	const Texture* get(unsigned int id);	// marks the texture as used this frame, NULL until it is resident
+	void update();	// once per frame, after TextureLoader::processUploads
+	void clearCache();
+
+	void setBudget(size_t budgetBytes);
+	size_t getBudget() const;
+	size_t getResidentBytes() const;
+	unsigned int getNumEvictions() const;
+	unsigned int getNumDroppedLevels() const;
+
+private:
+	struct Entry
+	{
+		std::string file_path;
+		TextureHandle handle;
+		TextureHandle replacement;	// the same texture at replacement_level, swapped in once it is ready
+		unsigned int first_level, replacement_level;
+		unsigned int last_used_frame;
+		std::list<unsigned int>::iterator lru_position;
+	};
+
+	TextureLoader &loader;
+	std::vector<Entry> entries;
+	std::list<unsigned int> lru;	// most recently used first
+	size_t budget, resident_bytes;
+	unsigned int frame_number, num_evictions, num_dropped_levels;
+
+	void swap_in_replacements();
+	void enforce_budget();
+	void restore_levels();
+	void reload(Entry &entry, unsigned int firstLevel);
+};
+
+#endif // !TEXTURECACHE_H
@@ -0,0 +1,349 @@
+#include "TextureFile.h"
+
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "stb_image.h"
+#include "CpuProfiler.h"
+
+namespace
+{
+	const uint32_t TEXTURE_FILE_MAGIC = 0x54474C4F;	// "OGLT"
+	const uint32_t TEXTURE_FILE_VERSION = 1;
+	const uint32_t FORMAT_UNCOMPRESSED = 0;			// anything else is a BlockFormat + 1
+	const unsigned int MAX_LEVELS = 32;
+	const size_t LEVEL_ALIGNMENT = 16;
+	const size_t PAGE_SIZE = 4096;
+	const std::string TEXTURE_FILE_EXTENSION = ".oglt";
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t num_channels;
+		uint32_t width, height;
+		uint32_t num_levels;
+		uint32_t reserved;
+	};
+
+	struct FileLevel
+	{
+		uint64_t offset, size;
+		uint32_t width, height;
+	};
+
+	size_t expected_level_size(uint32_t format, uint32_t numChannels, int width, int height)
+	{
+		if (format == FORMAT_UNCOMPRESSED)
+		{
+			return (size_t)width * height * numChannels;
+		}
+		return BlockCompressor::levelSize((BlockFormat)(format - 1), width, height);
+	}
+
+	// Header, level table, then the levels in order, each starting on a 16 byte boundary
+	bool write_file(const std::string &filePath, uint32_t format, int numChannels, const std::vector<TextureFileLevel> &levels)
+	{
+		std::ofstream file(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "Failed to write texture file: " << filePath << std::endl;
+			return false;
+		}
+
+		FileHeader header;
+		header.magic = TEXTURE_FILE_MAGIC;
+		header.version = TEXTURE_FILE_VERSION;
+		header.format = format;
+		header.num_channels = (uint32_t)numChannels;
+		header.width = (uint32_t)levels[0].width;
+		header.height = (uint32_t)levels[0].height;
+		header.num_levels = (uint32_t)levels.size();
+		header.reserved = 0;
+		file.write((const char*)&header, sizeof(header));
+
+		uint64_t offset = sizeof(FileHeader) + levels.size() * sizeof(FileLevel);
+		for (const TextureFileLevel &level : levels)
+		{
+			offset = (offset + LEVEL_ALIGNMENT - 1) & ~(uint64_t)(LEVEL_ALIGNMENT - 1);
+			FileLevel entry;
+			entry.offset = offset;
+			entry.size = level.size;
+			entry.width = (uint32_t)level.width;
+			entry.height = (uint32_t)level.height;
+			file.write((const char*)&entry, sizeof(entry));
+			offset += level.size;
+		}
+
+		const char padding[LEVEL_ALIGNMENT] = {};
+		for (const TextureFileLevel &level : levels)
+		{
+			size_t position = (size_t)file.tellp();
+			file.write(padding, (LEVEL_ALIGNMENT - position % LEVEL_ALIGNMENT) % LEVEL_ALIGNMENT);
+			file.write((const char*)level.data, level.size);
+		}
+		return file.good();
+	}
+}
+
+TextureFile::TextureFile()
+{
+	mapped = NULL;
+	mapped_size = 0;
+#ifdef _WIN32
+	file_handle = INVALID_HANDLE_VALUE;
+	mapping_handle = NULL;
+#else
+	file_descriptor = -1;
+#endif
+}
+
+TextureFile::~TextureFile()
+{
+	close();
+}
+
+// Maps the whole file read only and checks that the header and level table describe data that is really there
+bool TextureFile::open(const std::string &filePath)
+{
+	close();
+
+#ifdef _WIN32
+	file_handle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER fileSize;
+	if (file_handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_handle, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(FileHeader))
+	{
+		std::cout << "Failed to open texture file: " << filePath << std::endl;
+		close();
+		return false;
+	}
+	mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	mapped = mapping_handle ? (const unsigned char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0) : NULL;
+	mapped_size = (size_t)fileSize.QuadPart;
+#else
+	file_descriptor = ::open(filePath.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (file_descriptor < 0 || fstat(file_descriptor, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(FileHeader))
+	{
+		std::cout << "Failed to open texture file: " << filePath << std::endl;
+		close();
+		return false;
+	}
+	void* view = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	mapped = view != MAP_FAILED ? (const unsigned char*)view : NULL;
+	mapped_size = (size_t)fileStat.st_size;
+#endif
+
+	if (!mapped)
+	{
+		std::cout << "Failed to map texture file: " << filePath << std::endl;
+		close();
+		return false;
+	}
+	if (!validate(filePath))
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void TextureFile::close()
+{
+#ifdef _WIN32
+	if (mapped)
+	{
+		UnmapViewOfFile(mapped);
+	}
+	if (mapping_handle)
+	{
+		CloseHandle(mapping_handle);
+		mapping_handle = NULL;
+	}
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mapped)
+	{
+		munmap((void*)mapped, mapped_size);
+	}
+	if (file_descriptor >= 0)
+	{
+		::close(file_descriptor);
+		file_descriptor = -1;
+	}
+#endif
+	mapped = NULL;
+	mapped_size = 0;
+}
+
+void TextureFile::prefetch() const
+{
+	CPU_PROFILE_ZONE("Prefetch texture file");
+	volatile unsigned char sink = 0;
+	for (size_t offset = 0; offset < mapped_size; offset += PAGE_SIZE)
+	{
+		sink ^= mapped[offset];
+	}
+	(void)sink;
+}
+
+bool TextureFile::isOpen() const
+{
+	return mapped != NULL;
+}
+
+bool TextureFile::isCompressed() const
+{
+	return isOpen() && ((const FileHeader*)mapped)->format != FORMAT_UNCOMPRESSED;
+}
+
+BlockFormat TextureFile::getBlockFormat() const
+{
+	return isCompressed() ? (BlockFormat)(((const FileHeader*)mapped)->format - 1) : BLOCK_BC1;
+}
+
+int TextureFile::getWidth() const
+{
+	return isOpen() ? (int)((const FileHeader*)mapped)->width : 0;
+}
+
+int TextureFile::getHeight() const
+{
+	return isOpen() ? (int)((const FileHeader*)mapped)->height : 0;
+}
+
+int TextureFile::getNumChannels() const
+{
+	return isOpen() ? (int)((const FileHeader*)mapped)->num_channels : 0;
+}
+
+unsigned int TextureFile::getNumLevels() const
+{
+	return isOpen() ? ((const FileHeader*)mapped)->num_levels : 0;
+}
+
+TextureFileLevel TextureFile::getLevel(unsigned int level) const
+{
+	const FileLevel* entry = (const FileLevel*)(mapped + sizeof(FileHeader)) + level;
+	TextureFileLevel result;
+	result.width = (int)entry->width;
+	result.height = (int)entry->height;
+	result.data = mapped + entry->offset;
+	result.size = (size_t)entry->size;
+	return result;
+}
+
+bool TextureFile::write(const std::string &filePath, const unsigned char* pixels, int width, int height, int numChannels, const std::vector<MipLevel> &mips)
+{
+	std::vector<TextureFileLevel> levels;
+	TextureFileLevel base = { width, height, pixels, (size_t)width * height * numChannels };
+	levels.push_back(base);
+	for (const MipLevel &mip : mips)
+	{
+		TextureFileLevel level = { mip.width, mip.height, mip.pixels.data(), mip.pixels.size() };
+		levels.push_back(level);
+	}
+	return write_file(filePath, FORMAT_UNCOMPRESSED, numChannels, levels);
+}
+
+bool TextureFile::write(const std::string &filePath, BlockFormat format, const std::vector<CompressedLevel> &levels)
+{
+	std::vector<TextureFileLevel> fileLevels;
+	for (const CompressedLevel &level : levels)
+	{
+		TextureFileLevel fileLevel = { level.width, level.height, level.blocks.data(), level.blocks.size() };
+		fileLevels.push_back(fileLevel);
+	}
+	return write_file(filePath, (uint32_t)format + 1, BlockCompressor::channelsForFormat(format), fileLevels);
+}
+
+// Decodes inputPath, builds the full mip chain (in linear light for colour images, like TextureLoader does) and
+// writes it out, block compressed if compress is set
+bool TextureFile::convert(const std::string &inputPath, const std::string &outputPath, bool compress)
+{
+	int width = 0, height = 0, numChannels = 0;
+	unsigned char* pixels = stbi_load(inputPath.c_str(), &width, &height, &numChannels, 0);
+	if (!pixels)
+	{
+		std::cout << "Failed to load texture: " << inputPath << " (" << stbi_failure_reason() << ")" << std::endl;
+		return false;
+	}
+
+	std::vector<MipLevel> mips;
+	MipGenerator mipGenerator;
+	mipGenerator.generate(pixels, width, height, numChannels, numChannels >= 3, mips);
+
+	bool written;
+	if (compress)
+	{
+		BlockFormat format = BlockCompressor::formatForChannels(numChannels);
+		std::vector<CompressedLevel> levels;
+		BlockCompressor blockCompressor;
+		blockCompressor.compressChain(pixels, width, height, numChannels, mips, format, levels);
+		written = write(outputPath, format, levels);
+	}
+	else
+	{
+		written = write(outputPath, pixels, width, height, numChannels, mips);
+	}
+	stbi_image_free(pixels);
+
+	if (written)
+	{
+		std::cout << "Converted " << inputPath << " (" << width << "x" << height << ", " << numChannels << " channels, "
+			<< mips.size() + 1 << " levels" << (compress ? ", block compressed" : "") << ") to " << outputPath << std::endl;
+	}
+	return written;
+}
+
+bool TextureFile::isTextureFile(const std::string &filePath)
+{
+	return filePath.size() >= TEXTURE_FILE_EXTENSION.size() &&
+		filePath.compare(filePath.size() - TEXTURE_FILE_EXTENSION.size(), TEXTURE_FILE_EXTENSION.size(), TEXTURE_FILE_EXTENSION) == 0;
+}
+
+bool TextureFile::validate(const std::string &filePath) const
+{
+	const FileHeader* header = (const FileHeader*)mapped;
+	if (header->magic != TEXTURE_FILE_MAGIC || header->version != TEXTURE_FILE_VERSION)
+	{
+		std::cout << "Error in TextureFile::open --> " << filePath << " is not a version " << TEXTURE_FILE_VERSION << " texture file" << std::endl;
+		return false;
+	}
+	if (header->format > (uint32_t)BLOCK_BC5 + 1 || header->num_channels < 1 || header->num_channels > 4 ||
+		header->num_levels < 1 || header->num_levels > MAX_LEVELS ||
+		mapped_size < sizeof(FileHeader) + header->num_levels * sizeof(FileLevel))
+	{
+		std::cout << "Error in TextureFile::open --> " << filePath << " has a corrupt header" << std::endl;
+		return false;
+	}
+
+	for (unsigned int i = 0; i < header->num_levels; i++)
+	{
+		const FileLevel* entry = (const FileLevel*)(mapped + sizeof(FileHeader)) + i;
+		if (entry->offset > mapped_size || entry->size > mapped_size - entry->offset ||
+			entry->size != expected_level_size(header->format, header->num_channels, (int)entry->width, (int)entry->height) ||
+			(i == 0 && (entry->width != header->width || entry->height != header->height)))
+		{
+			std::cout << "Error in TextureFile::open --> " << filePath << " level " << i << " is truncated or corrupt" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef TEXTUREFILE_H
+#define TEXTUREFILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+
+struct TextureFileLevel
+{
+	int width, height;
+	const unsigned char* data;	// points into the mapping, valid until the file is closed
+	size_t size;
+};
+
+// Native texture container (.oglt): a small header, a level table and every mip level already in the layout GL
+// uploads from, either tightly packed 8 bit pixels or BC blocks. Files are memory mapped instead of read, so opening
+// one costs a few page table entries and the upload reads straight out of the page cache, with no decode at all.
+// TextureFile::convert builds one from anything stb_image can read (see --convert in main)
+class TextureFile
+{
+public:
+	TextureFile();
+	~TextureFile();
+
+	bool open(const std::string &filePath);
+	void close();
+	void prefetch() const;	// touches every page, so the upload does not stall on page faults (call it off the GL thread)
+
+	bool isOpen() const;
+	bool isCompressed() const;
+	BlockFormat getBlockFormat() const;	// only meaningful if isCompressed()
+	int getWidth() const;
+	int getHeight() const;
+	int getNumChannels() const;
+	unsigned int getNumLevels() const;
+	TextureFileLevel getLevel(unsigned int level) const;
+
+	static bool write(const std::string &filePath, const unsigned char* pixels, int width, int height, int numChannels, const std::vector<MipLevel> &mips);
+	static bool write(const std::string &filePath, BlockFormat format, const std::vector<CompressedLevel> &levels);
+	static bool convert(const std::string &inputPath, const std::string &outputPath, bool compress);
+	static bool isTextureFile(const std::string &filePath);	// by extension
+
+private:
+	TextureFile(const TextureFile&) = delete;
+	TextureFile& operator=(const TextureFile&) = delete;
+
+	const unsigned char* mapped;
+	size_t mapped_size;
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#else
+	int file_descriptor;
+#endif
+
+	bool validate(const std::string &filePath) const;
+};
+
+#endif // !TEXTUREFILE_H
@@ -0,0 +1,401 @@
+#include "TextureLoader.h"
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include "stb_image.h"
+#include "CpuProfiler.h"
+
+// ---- TextureHandle ----
+
+TextureHandle::TextureHandle()
+{
+
+}
+
+TextureHandle::TextureHandle(std::shared_ptr<TextureLoadState> state) : state(state)
+{
+
+}
+
+TextureStatus TextureHandle::getStatus() const
+{
+	if (!state)
+	{
+		return TextureStatus::Failed;
+	}
+	return state->status.load(std::memory_order_acquire);
+}
+
+bool TextureHandle::isEmpty() const
+{
+	return !state;
+}
+
+bool TextureHandle::isPending() const
+{
+	return getStatus() == TextureStatus::Pending;
+}
+
+bool TextureHandle::isReady() const
+{
+	return getStatus() == TextureStatus::Ready;
+}
+
+bool TextureHandle::isFailed() const
+{
+	return getStatus() == TextureStatus::Failed;
+}
+
+const Texture& TextureHandle::getTexture() const
+{
+	static const Texture emptyTexture;
+	if (!isReady())
+	{
+		return emptyTexture;
+	}
+	return state->texture;
+}
+
+const std::string& TextureHandle::getFilePath() const
+{
+	static const std::string emptyPath;
+	return state ? state->filePath : emptyPath;
+}
+
+// Cancelling is only a request, a decode already in flight finishes but its result is dropped instead of uploaded
+void TextureHandle::cancel()
+{
+	if (state)
+	{
+		state->cancelled.store(true, std::memory_order_release);
+	}
+}
+
+void TextureHandle::release()
+{
+	if (!state)
+	{
+		return;
+	}
+
+	state->cancelled.store(true, std::memory_order_release);
+	if (isReady())
+	{
+		state->texture.clearTexture();
+	}
+	state.reset();
+}
+
+// ---- TextureLoader ----
+
+TextureLoader::TextureLoader(unsigned int numThreads) : stopping(false), completed_head(nullptr), num_pending(0), upload_ring(NULL), mip_generator(NULL), block_compressor(NULL)
+{
+	if (numThreads == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		workers.emplace_back(&TextureLoader::worker_loop, this);
+	}
+}
+
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		stopping = true;
+	}
+	job_available.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	// Free anything that was decoded but never uploaded
+	drain_completed();
+	for (auto &state : upload_queue)
+	{
+		release_pixels(*state);
+	}
+}
+
+// Queues filePath for decoding and returns immediately, the returned handle reports when the texture is usable
+TextureHandle TextureLoader::load(const std::string &filePath, unsigned int firstLevel)
+{
+	std::shared_ptr<TextureLoadState> state = std::make_shared<TextureLoadState>(filePath);
+	state->first_level = firstLevel;
+	num_pending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		job_queue.push_back(state);
+	}
+	job_available.notify_one();
+
+	return TextureHandle(state);
+}
+
+unsigned int TextureLoader::processUploads(double budgetMilliseconds)
+{
+	drain_completed();
+	if (upload_ring)
+	{
+		upload_ring->mapFreeSlots();
+	}
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+	unsigned int uploaded = 0;
+
+	while (!upload_queue.empty())
+	{
+		std::shared_ptr<TextureLoadState> state = upload_queue.front();
+		upload_queue.pop_front();
+		num_pending.fetch_sub(1, std::memory_order_relaxed);
+
+		if (state->cancelled.load(std::memory_order_acquire))
+		{
+			release_pixels(*state);
+			state->status.store(TextureStatus::Cancelled, std::memory_order_release);
+			continue;
+		}
+
+		if (!state->pixels && state->compressed.empty() && !state->file.isOpen() && state->upload_slot < 0)
+		{
+			state->status.store(TextureStatus::Failed, std::memory_order_release);
+			continue;
+		}
+
+		// Uncompressed levels the worker could fit into a ring slot are already in GL memory, everything else goes up
+		// from client memory
+		if (state->upload_slot >= 0)
+		{
+			int slot = state->upload_slot;
+			state->upload_slot = -1;
+			if (!upload_ring->uploadSlot(slot, state->texture, std::max(state->width >> state->first_level, 1),
+				std::max(state->height >> state->first_level, 1), state->num_channels, state->num_slot_levels))
+			{
+				state->status.store(TextureStatus::Failed, std::memory_order_release);
+				continue;
+			}
+		}
+		else if (state->file.isOpen())
+		{
+			state->texture.createFromFile(state->file, state->first_level);
+		}
+		else if (!state->compressed.empty())
+		{
+			state->texture.createCompressed(state->compressed_format, state->compressed, state->first_level);
+		}
+		else if (!state->mips.empty())
+		{
+			state->texture.createWithMips(state->pixels, state->width, state->height, state->num_channels, state->mips, state->first_level);
+		}
+		else
+		{
+			state->texture.createFromPixels(state->pixels, state->width, state->height, state->num_channels);
+		}
+		release_pixels(*state);
+		state->status.store(TextureStatus::Ready, std::memory_order_release);
+		uploaded++;
+
+		std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		if (elapsed.count() >= budgetMilliseconds)
+		{
+			break;
+		}
+	}
+
+	return uploaded;
+}
+
+// Number of loads that have been requested but not yet uploaded, failed or been dropped
+unsigned int TextureLoader::getNumPending() const
+{
+	return num_pending.load(std::memory_order_relaxed);
+}
+
+void TextureLoader::setPixelBufferRing(PixelBufferRing* ring)
+{
+	upload_ring = ring;
+}
+
+void TextureLoader::setMipGenerator(MipGenerator* generator)
+{
+	mip_generator = generator;
+}
+
+void TextureLoader::setBlockCompressor(BlockCompressor* compressor)
+{
+	block_compressor = compressor;
+}
+
+void TextureLoader::worker_loop()
+{
+	CpuProfiler::setThreadName("Texture loader");
+	while (true)
+	{
+		std::shared_ptr<TextureLoadState> state;
+		{
+			std::unique_lock<std::mutex> lock(job_mutex);
+			job_available.wait(lock, [this] { return stopping || !job_queue.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			state = job_queue.front();
+			job_queue.pop_front();
+		}
+
+		// Skip the decode entirely if the caller lost interest while the job was queued
+		if (state->cancelled.load(std::memory_order_acquire))
+		{
+			push_completed(state);
+			continue;
+		}
+
+		if (TextureFile::isTextureFile(state->filePath))
+		{
+			// Nothing to decode, fault the pages in here so the upload on the GL thread only copies
+			if (state->file.open(state->filePath))
+			{
+				state->file.prefetch();
+			}
+		}
+		else
+		{
+			CPU_PROFILE_ZONE("Decode texture");
+			state->pixels = stbi_load(state->filePath.c_str(), &state->width, &state->height, &state->num_channels, 0);
+			if (!state->pixels)
+			{
+				std::cout << "Failed to load texture: " << state->filePath << " (" << stbi_failure_reason() << ")" << std::endl;
+			}
+			else if (mip_generator)
+			{
+				// stb_image hands out colour images as sRGB, one and two channel images are usually data (masks, heights)
+				bool srgb = state->num_channels >= 3;
+				mip_generator->generate(state->pixels, state->width, state->height, state->num_channels, srgb, state->mips);
+			}
+			state->first_level = std::min(state->first_level, (unsigned int)state->mips.size());	// nothing smaller without mips
+
+			BlockFormat format = BlockCompressor::formatForChannels(state->num_channels);
+			if (state->pixels && block_compressor && BlockCompressor::isSupported(format))
+			{
+				// Only the blocks are uploaded, the 8 bit copies can go right away
+				block_compressor->compressChain(state->pixels, state->width, state->height, state->num_channels, state->mips, format,
+					state->compressed, state->first_level);
+				state->compressed_format = format;
+				stbi_image_free(state->pixels);
+				state->pixels = NULL;
+				std::vector<MipLevel>().swap(state->mips);
+			}
+			else if (state->pixels && upload_ring)
+			{
+				copy_to_upload_slot(*state);
+			}
+		}
+
+		push_completed(state);
+	}
+}
+
+// Lock-free push (Treiber stack), the release ordering publishes the decoded pixels to the GL thread
+void TextureLoader::push_completed(const std::shared_ptr<TextureLoadState> &state)
+{
+	CompletedNode* node = new CompletedNode;
+	node->state = state;
+	node->next = completed_head.load(std::memory_order_relaxed);
+	while (!completed_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+// Takes the whole completed stack in a single exchange (so no ABA problem) and appends it in completion order
+void TextureLoader::drain_completed()
+{
+	CompletedNode* node = completed_head.exchange(nullptr, std::memory_order_acquire);
+
+	CompletedNode* reversed = nullptr;
+	while (node)
+	{
+		CompletedNode* next = node->next;
+		node->next = reversed;
+		reversed = node;
+		node = next;
+	}
+
+	while (reversed)
+	{
+		CompletedNode* next = reversed->next;
+		upload_queue.push_back(reversed->state);
+		delete reversed;
+		reversed = next;
+	}
+}
+
+// Writes the levels that will be uploaded into a mapped ring slot, back to back, so the GL thread does not touch the
+// pixels at all. Keeps the client copy if no slot is free
+void TextureLoader::copy_to_upload_slot(TextureLoadState &state)
+{
+	// Level 0 is pixels and level i is mips[i - 1], as in Texture::createWithMips
+	const unsigned int numLevels = (unsigned int)state.mips.size() + 1 - state.first_level;
+	GLsizeiptr size = 0;
+	for (unsigned int level = state.first_level; level < state.first_level + numLevels; level++)
+	{
+		size += level == 0 ? (GLsizeiptr)state.width * state.height * state.num_channels : (GLsizeiptr)state.mips[level - 1].pixels.size();
+	}
+
+	unsigned char* data = NULL;
+	int slot = upload_ring->acquireSlot(size, &data);
+	if (slot < 0)
+	{
+		return;
+	}
+
+	CPU_PROFILE_ZONE("Copy to upload slot");
+	for (unsigned int level = state.first_level; level < state.first_level + numLevels; level++)
+	{
+		if (level == 0)
+		{
+			size_t bytes = (size_t)state.width * state.height * state.num_channels;
+			memcpy(data, state.pixels, bytes);
+			data += bytes;
+		}
+		else
+		{
+			const std::vector<unsigned char> &pixels = state.mips[level - 1].pixels;
+			memcpy(data, pixels.data(), pixels.size());
+			data += pixels.size();
+		}
+	}
+	upload_ring->finishSlot(slot);
+
+	stbi_image_free(state.pixels);
+	state.pixels = NULL;
+	std::vector<MipLevel>().swap(state.mips);
+	state.upload_slot = slot;
+	state.num_slot_levels = numLevels;
+}
+
+void TextureLoader::release_pixels(TextureLoadState &state)
+{
+	if (state.upload_slot >= 0 && upload_ring)
+	{
+		upload_ring->returnSlot(state.upload_slot);
+		state.upload_slot = -1;
+	}
+	if (state.pixels)
+	{
+		stbi_image_free(state.pixels);
+		state.pixels = NULL;
+	}
+	std::vector<MipLevel>().swap(state.mips);
+	std::vector<CompressedLevel>().swap(state.compressed);
+	state.file.close();
+}
@@ -0,0 +1,120 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Texture.h"
+#include "PixelBufferRing.h"
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+
+enum class TextureStatus
+{
+	Pending,
+	Ready,
+	Failed,
+	Cancelled
+};
+
+// Shared state of one asynchronous load, owned jointly by the loader and every TextureHandle that refers to it
+struct TextureLoadState
+{
+	std::string filePath;
+	std::atomic<TextureStatus> status;
+	std::atomic<bool> cancelled;
+
+	// Written by a worker thread, read by the GL thread once the state has been handed over through the completed queue
+	unsigned char* pixels;
+	int width, height, num_channels;
+	std::vector<MipLevel> mips;	// empty unless the loader has a MipGenerator
+	std::vector<CompressedLevel> compressed;	// empty unless the loader has a BlockCompressor
+	BlockFormat compressed_format;
+	TextureFile file;	// texture files are mapped instead of decoded
+	unsigned int first_level;	// number of the largest levels left out
+	int upload_slot;	// PixelBufferRing slot the worker wrote the levels into (pixels and mips are freed then), -1 if none
+	unsigned int num_slot_levels;	// levels in upload_slot, starting at first_level
+
+	// Only touched by the GL thread
+	Texture texture;
+
+	TextureLoadState(const std::string &path) : filePath(path), status(TextureStatus::Pending), cancelled(false),
+		pixels(NULL), width(0), height(0), num_channels(0), compressed_format(BLOCK_BC1), first_level(0), upload_slot(-1), num_slot_levels(0) {}
+};
+
+// Caller side view of an asynchronous texture load
+class TextureHandle
+{
+public:
+	TextureHandle();
+	explicit TextureHandle(std::shared_ptr<TextureLoadState> state);
+
+	TextureStatus getStatus() const;
+	bool isEmpty() const;	// default constructed or released, as opposed to a load that failed
+	bool isPending() const;
+	bool isReady() const;
+	bool isFailed() const;
+	const Texture& getTexture() const;	// only valid once isReady() returns true
+	const std::string& getFilePath() const;
+	void cancel();
+	void release();	// GL thread only, deletes the texture (or cancels the load) and empties the handle
+
+private:
+	std::shared_ptr<TextureLoadState> state;
+};
+
+// Decodes image files on a pool of worker threads and uploads the results on the GL thread within a per frame time budget
+// Workers hand finished pixel buffers to the GL thread through a lock-free stack, so the frame loop never waits on a decode
+class TextureLoader
+{
+public:
+	TextureLoader(unsigned int numThreads = 0);	// 0 picks one worker per hardware thread, leaving one for the render thread
+	~TextureLoader();
+
+	// firstLevel > 0 loads a smaller version, leaving out that many of the largest mip levels. Decoded images need a
+	// MipGenerator for that, texture files already carry their levels
+	TextureHandle load(const std::string &filePath, unsigned int firstLevel = 0);
+
+	// Must be called on the GL thread, uploads finished decodes until budgetMilliseconds has elapsed (always uploads at least one)
+	unsigned int processUploads(double budgetMilliseconds);
+
+	unsigned int getNumPending() const;
+	void setPixelBufferRing(PixelBufferRing* ring);	// workers write uncompressed levels into ring's mapped slots, NULL to disable
+	void setMipGenerator(MipGenerator* generator);	// build mip chains on the workers instead of with glGenerateMipmap, NULL to disable
+	void setBlockCompressor(BlockCompressor* compressor);	// block compress on the workers (formats the driver supports), NULL to disable
+
+private:
+	// Intrusive node of the lock-free completed stack, pushed by workers and drained in one exchange by the GL thread
+	struct CompletedNode
+	{
+		std::shared_ptr<TextureLoadState> state;
+		CompletedNode* next;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<std::shared_ptr<TextureLoadState>> job_queue;
+	std::mutex job_mutex;
+	std::condition_variable job_available;
+	bool stopping;
+
+	std::atomic<CompletedNode*> completed_head;
+	std::deque<std::shared_ptr<TextureLoadState>> upload_queue; // GL thread only
+	std::atomic<unsigned int> num_pending;
+	PixelBufferRing* upload_ring;
+	MipGenerator* mip_generator;
+	BlockCompressor* block_compressor;
+
+	void worker_loop();
+	void push_completed(const std::shared_ptr<TextureLoadState> &state);
+	void drain_completed();
+	void copy_to_upload_slot(TextureLoadState &state);
+	void release_pixels(TextureLoadState &state);
+};
+
+#endif // !TEXTURELOADER_H
@@ -0,0 +1,84 @@
+#include "UniformBuffer.h"
+
+UniformBuffer::UniformBuffer()
+{
+	buffer_ID = 0;
+	binding_point = 0;
+	buffer_size = 0;
+}
+
+UniformBuffer::~UniformBuffer()
+{
+
+}
+
+void UniformBuffer::create(GLuint bindingPoint, GLsizeiptr size)
+{
+	binding_point = bindingPoint;
+	buffer_size = size;
+
+	glGenBuffers(1, &buffer_ID);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer_ID);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// The buffer stays attached to its binding point for its whole life, programs only need their block index bound
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding_point, buffer_ID);
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size)
+{
+	if (size > buffer_size)
+	{
+		std::cout << "Error in UniformBuffer::update --> " << size << " bytes do not fit into buffer " << buffer_ID << " of " << buffer_size << " bytes" << std::endl;
+		return;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer_ID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::clearBuffer()
+{
+	if (buffer_ID == 0)
+	{
+		std::cout << "Error in UniformBuffer::clearBuffer --> buffer_ID == " << buffer_ID << ", (tried to clear unallocated buffer)" << std::endl;
+		return;
+	}
+
+	glDeleteBuffers(1, &buffer_ID);
+	buffer_ID = 0;
+	buffer_size = 0;
+}
+
+GLuint UniformBuffer::getID() const
+{
+	return buffer_ID;
+}
+
+GLuint UniformBuffer::getBindingPoint() const
+{
+	return binding_point;
+}
+
+// Name of the GLSL uniform block that lives at bindingPoint, NULL if nothing is assigned to it
+const char* UniformBuffer::blockNameForBinding(GLuint bindingPoint)
+{
+	switch (bindingPoint)
+	{
+	case FRAME_UNIFORMS_BINDING: return "FrameUniforms";
+	case CAMERA_UNIFORMS_BINDING: return "CameraUniforms";
+	default: return NULL;
+	}
+}
+
+GLsizeiptr UniformBuffer::blockSizeForBinding(GLuint bindingPoint)
+{
+	switch (bindingPoint)
+	{
+	case FRAME_UNIFORMS_BINDING: return sizeof(FrameUniforms);
+	case CAMERA_UNIFORMS_BINDING: return sizeof(CameraUniforms);
+	default: return 0;
+	}
+}
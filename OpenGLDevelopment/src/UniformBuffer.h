@@ -0,0 +1,66 @@
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <cstddef>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// Binding points of the shared uniform blocks, every program gets its blocks bound to these right after linking
+// (see Shader::bind_uniform_blocks), the GLSL side of the blocks is in shaders/uniforms.glsl
+enum UniformBlockBinding
+{
+	FRAME_UNIFORMS_BINDING = 0,
+	CAMERA_UNIFORMS_BINDING = 1
+};
+
+// std140 rules used by the blocks below: scalars align to 4 bytes, vec4 and mat4 columns to 16, and the block size rounds
+// up to 16. Keeping the C++ structs to whole vec4s and mat4s makes their memory layout match std140 exactly
+struct FrameUniforms
+{
+	float time;
+	float delta_time;
+	float frame_index;
+	float padding0;
+	float resolution[4];	// width, height, 1 / width, 1 / height
+};
+
+struct CameraUniforms
+{
+	float projection[16];	// column major, like glUniformMatrix4fv with transpose == GL_FALSE
+	float view[16];
+	float view_projection[16];
+	float position[4];
+};
+
+static_assert(offsetof(FrameUniforms, resolution) == 16, "FrameUniforms does not match its std140 layout");
+static_assert(sizeof(FrameUniforms) % 16 == 0, "FrameUniforms must be a multiple of 16 bytes for std140");
+static_assert(offsetof(CameraUniforms, view) == 64 && offsetof(CameraUniforms, view_projection) == 128 && offsetof(CameraUniforms, position) == 192,
+	"CameraUniforms does not match its std140 layout");
+static_assert(sizeof(CameraUniforms) % 16 == 0, "CameraUniforms must be a multiple of 16 bytes for std140");
+
+// A uniform buffer bound to a fixed binding point. The storage is allocated once and rewritten in place every frame,
+// which replaces setting the same uniforms on every program with a single buffer update
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	void create(GLuint bindingPoint, GLsizeiptr size);
+	void update(const void* data, GLsizeiptr size);
+	template <typename T> void update(const T &block) { update(&block, sizeof(T)); }
+	void clearBuffer();
+
+	GLuint getID() const;
+	GLuint getBindingPoint() const;
+
+	static const char* blockNameForBinding(GLuint bindingPoint);
+	static GLsizeiptr blockSizeForBinding(GLuint bindingPoint);
+
+private:
+	GLuint buffer_ID, binding_point;
+	GLsizeiptr buffer_size;
+};
+
+#endif // !UNIFORMBUFFER_H
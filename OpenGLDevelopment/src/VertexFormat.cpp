@@ -0,0 +1,255 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+#ifdef VERTEX_PACKING_SSE2
+#include <emmintrin.h>
+#endif
+
+VertexFormat::VertexFormat()
+{
+	stride = 0;
+}
+
+VertexFormat::~VertexFormat()
+{
+
+}
+
+VertexFormat& VertexFormat::add(GLuint location, VertexAttributeType type, GLint components)
+{
+	if (type == ATTRIBUTE_SNORM_2_10_10_10 && components != 4)
+	{
+		std::cout << "Error in VertexFormat::add --> packed 2_10_10_10 attributes always have 4 components, got " << components << std::endl;
+		components = 4;
+	}
+
+	Attribute attribute;
+	attribute.location = location;
+	attribute.type = type;
+	attribute.components = components;
+	attribute.offset = (stride + 3) & ~3;
+	attributes.push_back(attribute);
+
+	stride = (GLsizei)(attribute.offset + attributeSize(type, components) + 3) & ~3;
+	return *this;
+}
+
+void VertexFormat::apply() const
+{
+	for (const Attribute &attribute : attributes)
+	{
+		const void* offset = (const void*)attribute.offset;
+		switch (attribute.type)
+		{
+		case ATTRIBUTE_FLOAT:
+			glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, stride, offset);
+			break;
+		case ATTRIBUTE_HALF_FLOAT:
+			glVertexAttribPointer(attribute.location, attribute.components, GL_HALF_FLOAT, GL_FALSE, stride, offset);
+			break;
+		case ATTRIBUTE_UNORM8:
+			glVertexAttribPointer(attribute.location, attribute.components, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset);
+			break;
+		case ATTRIBUTE_UINT8:
+			glVertexAttribIPointer(attribute.location, attribute.components, GL_UNSIGNED_BYTE, stride, offset);
+			break;
+		case ATTRIBUTE_SNORM_2_10_10_10:
+			glVertexAttribPointer(attribute.location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, offset);
+			break;
+		}
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
+
+GLsizei VertexFormat::getStride() const
+{
+	return stride;
+}
+
+GLsizei VertexFormat::attributeSize(VertexAttributeType type, GLint components)
+{
+	switch (type)
+	{
+	case ATTRIBUTE_FLOAT: return 4 * components;
+	case ATTRIBUTE_HALF_FLOAT: return 2 * components;
+	case ATTRIBUTE_UNORM8: return components;
+	case ATTRIBUTE_UINT8: return components;
+	case ATTRIBUTE_SNORM_2_10_10_10: return 4;
+	}
+	return 0;
+}
+
+namespace
+{
+	uint32_t float_bits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	float bits_float(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	const uint32_t HALF_MAX_AS_FLOAT = (127 + 16) << 23;		// this and everything above overflows to infinity
+	const uint32_t HALF_MIN_NORMAL_AS_FLOAT = (127 - 14) << 23;	// everything below becomes a half subnormal
+	const uint32_t HALF_SUBNORMAL_MAGIC = ((127 - 15) + (23 - 10) + 1) << 23;
+
+#ifdef VERTEX_PACKING_SSE2
+	// Same steps as the scalar floatToHalf, with selects instead of branches
+	__m128i float_to_half_sse2(__m128 value)
+	{
+		const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+		__m128 sign = _mm_and_ps(value, _mm_castsi128_ps(signMask));
+		__m128 absolute = _mm_xor_ps(value, sign);
+		__m128i absoluteBits = _mm_castps_si128(absolute);
+
+		// Infinity and NaN (NaN keeps a mantissa bit so it stays NaN)
+		__m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute));
+		__m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNaN, _mm_set1_epi32(0x200)));
+		__m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((int)HALF_MAX_AS_FLOAT), absoluteBits);
+
+		// Subnormal results, the float add does the rounding for us
+		__m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32((int)HALF_MIN_NORMAL_AS_FLOAT), absoluteBits);
+		__m128 subnormalSum = _mm_add_ps(absolute, _mm_castsi128_ps(_mm_set1_epi32((int)HALF_SUBNORMAL_MAGIC)));
+		__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormalSum), _mm_set1_epi32((int)HALF_SUBNORMAL_MAGIC));
+
+		// Normal results, rebias the exponent and round the mantissa to nearest even
+		__m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absoluteBits, 31 - 13), 31);
+		__m128i rounded = _mm_sub_epi32(_mm_add_epi32(absoluteBits, _mm_set1_epi32((int)(0xFFF - ((127 - 15) << 23)))), mantissaOdd);
+		__m128i normal = _mm_srli_epi32(rounded, 13);
+
+		__m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+		__m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+		return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+	}
+#endif
+}
+
+uint16_t VertexPacking::floatToHalf(float value)
+{
+	uint32_t bits = float_bits(value);
+	uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t half;
+	if (bits >= HALF_MAX_AS_FLOAT)
+	{
+		half = bits > 0x7F800000u ? 0x7E00 : 0x7C00;
+	}
+	else if (bits < HALF_MIN_NORMAL_AS_FLOAT)
+	{
+		half = float_bits(bits_float(bits) + bits_float(HALF_SUBNORMAL_MAGIC)) - HALF_SUBNORMAL_MAGIC;
+	}
+	else
+	{
+		uint32_t mantissaOdd = (bits >> 13) & 1;
+		half = (bits + (uint32_t)(0xFFF - ((127 - 15) << 23)) + mantissaOdd) >> 13;
+	}
+	return (uint16_t)(half | (sign >> 16));
+}
+
+uint8_t VertexPacking::floatToUNorm8(float value)
+{
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+// Signed normalized 10 bit components hold -511..511, w is left at 0
+uint32_t VertexPacking::packNormal(float x, float y, float z)
+{
+	const float components[3] = { x, y, z };
+	uint32_t packed = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		float value = components[i] < -1.0f ? -1.0f : (components[i] > 1.0f ? 1.0f : components[i]);
+		int32_t quantized = (int32_t)std::lrint(value * 511.0f);
+		packed |= ((uint32_t)quantized & 0x3FF) << (i * 10);
+	}
+	return packed;
+}
+
+void VertexPacking::floatToHalf(const float* input, uint16_t* output, size_t count)
+{
+	size_t i = 0;
+#ifdef VERTEX_PACKING_SSE2
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i low = float_to_half_sse2(_mm_loadu_ps(input + i));
+		__m128i high = float_to_half_sse2(_mm_loadu_ps(input + i + 4));
+		// Halves are sign extended to 32 bits, so the signed saturating pack keeps every bit
+		_mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi32(low, high));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		output[i] = floatToHalf(input[i]);
+	}
+}
+
+void VertexPacking::floatToUNorm8(const float* input, uint8_t* output, size_t count)
+{
+	size_t i = 0;
+#ifdef VERTEX_PACKING_SSE2
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i quantized[4];
+		for (int j = 0; j < 4; j++)
+		{
+			__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(input + i + j * 4), zero), one);
+			quantized[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+		}
+		__m128i shorts0 = _mm_packs_epi32(quantized[0], quantized[1]);
+		__m128i shorts1 = _mm_packs_epi32(quantized[2], quantized[3]);
+		_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(shorts0, shorts1));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		output[i] = floatToUNorm8(input[i]);
+	}
+}
+
+void VertexPacking::packNormals(const float* normals, uint32_t* output, size_t count)
+{
+	size_t i = 0;
+#ifdef VERTEX_PACKING_SSE2
+	const __m128 minusOne = _mm_set1_ps(-1.0f), one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(511.0f);
+	const __m128i mask = _mm_set1_epi32(0x3FF);
+	for (; i + 4 <= count; i += 4)
+	{
+		// Three loads hold four xyz triples, regroup them into one register per component
+		__m128 a = _mm_loadu_ps(normals + i * 3);		// x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(normals + i * 3 + 4);	// y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(normals + i * 3 + 8);	// z2 x3 y3 z3
+		__m128 x0x1y0z0 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 1, 3, 0));
+		__m128 y0z0y1z1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+		__m128 x2y2x3y3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+		__m128 z2z3z2z3 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 3, 0));
+		__m128 x = _mm_shuffle_ps(x0x1y0z0, x2y2x3y3, _MM_SHUFFLE(2, 0, 1, 0));
+		__m128 y = _mm_shuffle_ps(y0z0y1z1, x2y2x3y3, _MM_SHUFFLE(3, 1, 2, 0));
+		__m128 z = _mm_shuffle_ps(y0z0y1z1, z2z3z2z3, _MM_SHUFFLE(1, 0, 3, 1));
+
+		__m128i xi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, minusOne), one), scale));
+		__m128i yi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(y, minusOne), one), scale));
+		__m128i zi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(z, minusOne), one), scale));
+		__m128i packed = _mm_or_si128(_mm_and_si128(xi, mask),
+			_mm_or_si128(_mm_slli_epi32(_mm_and_si128(yi, mask), 10), _mm_slli_epi32(_mm_and_si128(zi, mask), 20)));
+		_mm_storeu_si128((__m128i*)(output + i), packed);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		output[i] = packNormal(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define VERTEX_PACKING_SSE2
+#endif
+
+enum VertexAttributeType
+{
+	ATTRIBUTE_FLOAT,				// 4 bytes per component
+	ATTRIBUTE_HALF_FLOAT,			// 2 bytes per component, plenty for UVs and other values in a small range
+	ATTRIBUTE_UNORM8,				// 1 byte per component, read as 0..1 in the shader (colours)
+	ATTRIBUTE_UINT8,				// 1 byte per component, read as integers (indices, flags)
+	ATTRIBUTE_SNORM_2_10_10_10		// xyz 10 bits each plus 2 bits of w in 4 bytes, read as -1..1 (normals, tangents)
+};
+
+// Describes how vertices are laid out in a buffer and sets the matching attribute pointers. Attributes are packed in
+// the order they are added, each starting on a 4 byte boundary
+class VertexFormat
+{
+public:
+	VertexFormat();
+	~VertexFormat();
+
+	VertexFormat& add(GLuint location, VertexAttributeType type, GLint components);
+	void apply() const;	// the VAO and the vertex buffer must be bound
+
+	GLsizei getStride() const;
+
+	static GLsizei attributeSize(VertexAttributeType type, GLint components);
+
+private:
+	struct Attribute
+	{
+		GLuint location;
+		VertexAttributeType type;
+		GLint components;
+		size_t offset;
+	};
+
+	std::vector<Attribute> attributes;
+	GLsizei stride;
+};
+
+// Converts float vertex data into the packed attribute types, 4 values at a time with SSE2 where it is available.
+// Both paths round the same way so the output does not depend on the build
+namespace VertexPacking
+{
+	void floatToHalf(const float* input, uint16_t* output, size_t count);		// round to nearest even, overflow becomes infinity
+	void floatToUNorm8(const float* input, uint8_t* output, size_t count);		// clamped to 0..1, rounded to nearest
+	void packNormals(const float* normals, uint32_t* output, size_t count);		// xyz triples into 2_10_10_10, w = 0
+
+	uint16_t floatToHalf(float value);
+	uint8_t floatToUNorm8(float value);
+	uint32_t packNormal(float x, float y, float z);
+}
+
+#endif // !VERTEXFORMAT_H
@@ -10,8 +10,36 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
-
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+
+#include "BlockCompressor.h"
+#include "CpuProfiler.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "GpuProfiler.h"
+#include "HeadlessContext.h"
+#include "IndexBuffer.h"
+#include "InstanceBuffer.h"
+#include "MeshOptimizer.h"
+#include "MipGenerator.h"
+#include "OffscreenTarget.h"
+#include "RenderQueue.h"
+#include "SamplerCache.h"
 #include "Shader.h"
+#include "ShaderBatch.h"
+#include "ShaderWatcher.h"
+#include "SpriteBatch.h"
+#include "TextureArray.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "TextureFile.h"
+#include "TextureLoader.h"
+#include "UniformBuffer.h"
+#include "VertexFormat.h"
 
 
 
@@ -22,43 +50,221 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 // Global settings
 const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
+const double TEXTURE_UPLOAD_BUDGET_MS = 2.0; // Max time per frame spent uploading textures that finished decoding
+const unsigned int UPLOAD_RING_SLOTS = 4;
+const GLsizeiptr UPLOAD_RING_SLOT_SIZE = 4 * 1024 * 1024; // Enough for a 1024x1024 RGB image and its mip chain, slots grow if needed
+const double HEADLESS_FRAME_TIME = 1.0 / 60.0; // Headless runs use a fixed time step so their output is reproducible
+const unsigned int FRAME_GRAPH_SAMPLES = 120; // Frame times shown in the HUD graph
+const size_t DEFAULT_TEXTURE_BUDGET = 256 * 1024 * 1024;
 
 
-int main()
+int main(int argc, char* argv[])
 {
+	// Command line: --headless renders --frames N frames into an offscreen framebuffer and writes them to
+	// <--output prefix>_NNNN.ppm (or raw RGBA buffers with --raw) instead of opening a window.
+	// --trace path writes the CPU profiler zones to a Chrome trace file on exit.
+	// --instances N draws a grid of N spinning quads under the main one with a single instanced draw call.
+	// --sprite path (repeatable) adds an image to the HUD atlas and shows it under the frame graph.
+	// --layer path (repeatable) adds a same sized image to the texture array the instanced grid is drawn with.
+	// --compress block compresses streamed textures (BC1/BC3/BC4/BC5) on the loader threads.
+	// --convert input output writes input as a pre-mipped texture file (.oglt, block compressed with --compress) and exits.
+	// --texture-budget MB caps the estimated video memory of cached textures
+	bool headless = false, rawOutput = false, compressTextures = false;
+	unsigned int headlessFrames = 1;
+	std::string outputPrefix = "frame";
+	std::string tracePath;
+	unsigned int numInstances = 0;
+	std::vector<std::string> spritePaths, layerPaths;
+	std::string convertInput, convertOutput;
+	size_t textureBudget = DEFAULT_TEXTURE_BUDGET;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--headless")
+		{
+			headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			headlessFrames = (unsigned int)std::stoul(argv[++i]);
+		}
+		else if (arg == "--output" && i + 1 < argc)
+		{
+			outputPrefix = argv[++i];
+		}
+		else if (arg == "--raw")
+		{
+			rawOutput = true;
+		}
+		else if (arg == "--trace" && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (arg == "--instances" && i + 1 < argc)
+		{
+			numInstances = (unsigned int)std::stoul(argv[++i]);
+		}
+		else if (arg == "--sprite" && i + 1 < argc)
+		{
+			spritePaths.push_back(argv[++i]);
+		}
+		else if (arg == "--layer" && i + 1 < argc)
+		{
+			layerPaths.push_back(argv[++i]);
+		}
+		else if (arg == "--compress")
+		{
+			compressTextures = true;
+		}
+		else if (arg == "--texture-budget" && i + 1 < argc)
+		{
+			textureBudget = (size_t)std::stoul(argv[++i]) * 1024 * 1024;
+		}
+		else if (arg == "--convert" && i + 2 < argc)
+		{
+			convertInput = argv[++i];
+			convertOutput = argv[++i];
+		}
+		else
+		{
+			std::cout << "Ignoring unknown argument: " << arg << std::endl;
+		}
+	}
+
+	// Conversion needs no GL context
+	if (!convertInput.empty())
+	{
+		return TextureFile::convert(convertInput, convertOutput, compressTextures) ? 0 : -1;
+	}
+
 	///Init stuff
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	CpuProfiler::setThreadName("Main");
+	GLStateCache stateCache; // Program, VAO, texture and viewport changes go through here so redundant ones are skipped
+	GLFWwindow* window = NULL;
+	HeadlessContext headlessContext;
+	GLADloadproc loadProc = (GLADloadproc)glfwGetProcAddress;
 
-	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "OpenGLDevelopment", NULL, NULL);
+	if (headless && headlessContext.create())
+	{
+		loadProc = (GLADloadproc)HeadlessContext::getProcAddress;
+	}
+	else
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		if (headless)
+		{
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // No EGL on this platform, a hidden window still gives us a context
+		}
+
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "OpenGLDevelopment", NULL, NULL);
+
+		if (window == NULL)
+		{
+			std::cout << "Failed to create a GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+
+		glfwMakeContextCurrent(window);
+		glfwSetWindowUserPointer(window, &stateCache);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback); // Set callback function to be called each time window is resized
+	}
 
-	if (window == NULL)
+	if (!gladLoadGLLoader(loadProc))
 	{
-		std::cout << "Failed to create a GLFW window" << std::endl;
-		glfwTerminate();
+		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	GLExtensions::load(loadProc);
 
-	glfwMakeContextCurrent(window);
+	stateCache.setViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	// Headless frames are rendered into a framebuffer object and read back asynchronously
+	OffscreenTarget offscreenTarget;
+	if (headless && !offscreenTarget.create(SCREEN_WIDTH, SCREEN_HEIGHT, outputPrefix, rawOutput))
 	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
+		std::cout << "Failed to create the offscreen render target" << std::endl;
 		return -1;
 	}
-
-	glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback); // Set callback function to be called each time window is resized
 	/// End Init stuff
 
 
 	// Create a shader using the new shader class ------------------------------------------
-	Shader shader("shaders/shader.vert", "shaders/shader.frag");
+	ShaderCache shaderCache; // Linked programs are cached in shader_cache/ so warm starts skip GLSL compilation
+	Shader::setProgramCache(&shaderCache);
+	// All shaders go through one batch so the driver can compile them in parallel
+	Shader shader, instancedShader, spriteShader;
+	ShaderBatch shaderBatch;
+	shaderBatch.add(&shader, "shaders/shader.vert", "shaders/shader.frag");
+	shaderBatch.add(&instancedShader, "shaders/instanced.vert", "shaders/instanced.frag");
+	shaderBatch.add(&spriteShader, "shaders/sprite.vert", "shaders/sprite.frag");
+	shaderBatch.compile();
 	std::cout << "Shader created with ID " << shader.getID() << std::endl;
+	GLint xOffsetHandle = shader.getUniformHandle("xOffset"); // Resolve uniform handles once, outside of the main loop
+
+	//2. Set a horizontal offset via a uniform that we add to the vertex shader
+	// It never changes, and uniforms belong to the program, so it only needs setting when the program is (re)built
+	float xOffset = 0.0f; //set triangle back to center but left this offset in
+	stateCache.useProgram(shader.getID());
+	shader.setFloat(xOffsetHandle, xOffset);
+
+	// Recompile the shader whenever its source files are saved
+	ShaderWatcher shaderWatcher;
+	shaderWatcher.watch(&shader);
+	shaderWatcher.watch(&instancedShader);
+	shaderWatcher.watch(&spriteShader);
 	// -------------------------------------------------------------------------------------
 
+	// Per frame data shared by every shader program through uniform blocks, written once per frame
+	UniformBuffer frameUniformBuffer, cameraUniformBuffer;
+	frameUniformBuffer.create(FRAME_UNIFORMS_BINDING, sizeof(FrameUniforms));
+	cameraUniformBuffer.create(CAMERA_UNIFORMS_BINDING, sizeof(CameraUniforms));
+
+	// No camera yet, so every camera matrix is the identity
+	CameraUniforms cameraUniforms = {};
+	for (int i = 0; i < 4; i++)
+	{
+		cameraUniforms.projection[i * 5] = 1.0f;
+		cameraUniforms.view[i * 5] = 1.0f;
+		cameraUniforms.view_projection[i * 5] = 1.0f;
+	}
+	cameraUniforms.position[3] = 1.0f;
+
+	// GPU timings per render pass, results arrive a few frames late so reading them never stalls
+	GpuProfiler gpuProfiler;
+	gpuProfiler.create();
+
+	FrameUniforms frameUniforms = {};
+	unsigned int frameNumber = 0;
+	double lastFrameTime = headless ? 0.0 : glfwGetTime();
+
+	// Start decoding textures on worker threads, they get uploaded a few at a time from the main loop
+	// Mip chains are built next to the decode so the GL thread never runs glGenerateMipmap for them
+	PixelBufferRing uploadRing;
+	uploadRing.create(UPLOAD_RING_SLOTS, UPLOAD_RING_SLOT_SIZE);
+	MipGenerator mipGenerator;
+	BlockCompressor blockCompressor;
+	TextureLoader textureLoader;
+	textureLoader.setPixelBufferRing(&uploadRing);
+	textureLoader.setMipGenerator(&mipGenerator);
+	if (compressTextures)
+	{
+		textureLoader.setBlockCompressor(&blockCompressor);
+	}
+	// Textures are loaded on first use and kept within the budget, a converted copy
+	// (--convert container.jpg container.oglt) loads without decoding anything
+	TextureCache textureCache(textureLoader, textureBudget);
+	unsigned int containerTexture = textureCache.add(std::ifstream("container.oglt").good() ? "container.oglt" : "container.jpg");
+
+	// Filtering is chosen per draw rather than per texture. The spinning grid gets anisotropic filtering where the
+	// driver has it, HUD sprites clamp so atlas regions and thumbnails never pick up texels from the opposite edge
+	SamplerCache samplerCache;
+	const SamplerDesc gridSampler = SamplerCache::makeDesc(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, 8.0f);
+	const SamplerDesc spriteSampler = SamplerCache::makeDesc(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE);
+
 	// Create vertex and buffer data, configure vertex attributes
 	// -----------------------------------------------------------
 	// Create a box, with 3 types of attributes - position, color, and texture coords
@@ -70,36 +276,55 @@ int main()
 		-0.5f,  0.5f,  0.0f, 0.0f, 0.0f, 1.0f //top left
 	};
 	
+	// Pack the quad for the GPU, colors become normalized bytes so a vertex is 16 bytes instead of 24
+	struct QuadVertex
+	{
+		float position[3];
+		uint8_t color[4];
+	};
+	const unsigned int numQuadVertices = sizeof(vertices) / (6 * sizeof(float));
+	QuadVertex quadVertices[numQuadVertices];
+	for (unsigned int i = 0; i < numQuadVertices; i++)
+	{
+		const float* vertex = vertices + i * 6;
+		const float color[4] = { vertex[3], vertex[4], vertex[5], 1.0f };
+		memcpy(quadVertices[i].position, vertex, sizeof(quadVertices[i].position));
+		VertexPacking::floatToUNorm8(color, quadVertices[i].color, 4);
+	}
+	VertexFormat quadFormat;
+	quadFormat.add(0, ATTRIBUTE_FLOAT, 3).add(1, ATTRIBUTE_UNORM8, 4);
+
 	// Indices to create 2 triangles if using an EBO
-	unsigned int indices[] = {
+	uint32_t indices[] = {
 		0, 1, 3, //first triangle
 		1, 2, 3  //second triangle
 	};
+	const size_t numIndices = sizeof(indices) / sizeof(indices[0]);
+
+	// Reorder for the post transform cache and then for vertex fetch, before anything is uploaded
+	float acmrBefore = MeshOptimizer::computeACMR(indices, numIndices, numQuadVertices);
+	MeshOptimizer::optimizeVertexCache(indices, numIndices, numQuadVertices);
+	size_t numUsedVertices = MeshOptimizer::optimizeVertexFetch(quadVertices, numQuadVertices, sizeof(QuadVertex), indices, numIndices);
+	std::cout << "Quad mesh ACMR " << acmrBefore << " -> " << MeshOptimizer::computeACMR(indices, numIndices, numUsedVertices) << std::endl;
 
 	// Create and bind a Vertex Buffer Object and Vertex Array Object, and give them the data in the vertices[] array
-	// Also create an Element Buffer Object to hold
-	unsigned int VBO, VAO, EBO;
+	// Also create an Element Buffer Object to hold the indices, 16 bit ones since the quad has so few vertices
+	unsigned int VBO, VAO;
+	IndexBuffer quadIndices;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
 
 	// Bind the Vertex Array Object first, then bind/set the Vertex buffer object, then the element buffer object
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO); 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, numUsedVertices * sizeof(QuadVertex), quadVertices, GL_STATIC_DRAW);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	quadIndices.create(indices, numIndices, numUsedVertices);
 
-	// glVertexAttribPointer tells openGL how to process the vertex array data (starting at position 0 in the array, attributes have 3 values (vec3), data values are floats, stride of 3*varialble size, etc)
-	// The position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0); //This last param is the offset of where the position data begins in the buffer, and requires the cast (void*)
-	glEnableVertexAttribArray(0);
-
-	// The color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float))); //This last param is the offset of where the color data begins in the buffer, and requires the cast (void*)
-	glEnableVertexAttribArray(1);
+	// glVertexAttribPointer tells openGL how to process the vertex array data, the format makes one call per attribute
+	// The position attribute (3 floats) and the color attribute (4 normalized bytes, the shader still sees floats)
+	quadFormat.apply();
 
 	// The texture attribute
 	
@@ -111,48 +336,304 @@ int main()
 	// ** Can unbind the VAO so that other VAO calls won't accidentally modify this VAO, however this rarely happens since 
 	//		modifying other VAOs require a call to glBindVertexArray anyways
 	glBindVertexArray(0);
+
+	// A second VAO over the same quad buffers, plus a per instance attribute stream for the instanced grid
+	unsigned int instancedVAO;
+	glGenVertexArrays(1, &instancedVAO);
+	glBindVertexArray(instancedVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	quadIndices.bind();
+	quadFormat.apply();
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The grid's images all live in one texture array, so the whole grid is drawn with a single texture bind.
+	// Without --layer images it gets a few generated patterns
+	TextureArray instanceLayers;
+	if (layerPaths.empty() || !instanceLayers.loadFromFiles(layerPaths, &mipGenerator))
+	{
+		const int layerSize = 64, numLayers = 4;
+		instanceLayers.create(layerSize, layerSize, 4, numLayers);
+		std::vector<unsigned char> pattern(layerSize * layerSize * 4);
+		for (int layer = 0; layer < numLayers; layer++)
+		{
+			for (int y = 0; y < layerSize; y++)
+			{
+				for (int x = 0; x < layerSize; x++)
+				{
+					// Checkers, horizontal stripes, vertical stripes and a ring
+					bool lit = false;
+					int dx = x - layerSize / 2, dy = y - layerSize / 2;
+					switch (layer)
+					{
+					case 0: lit = ((x / 8) + (y / 8)) % 2 == 0; break;
+					case 1: lit = (y / 8) % 2 == 0; break;
+					case 2: lit = (x / 8) % 2 == 0; break;
+					default: lit = std::abs(dx * dx + dy * dy - 400) < 160; break;
+					}
+					unsigned char* pixel = &pattern[(y * layerSize + x) * 4];
+					pixel[0] = pixel[1] = pixel[2] = lit ? 255 : 64;
+					pixel[3] = 255;
+				}
+			}
+			instanceLayers.setLayer(layer, pattern.data());
+		}
+		instanceLayers.generateMipmaps();
+	}
+
+	InstanceBuffer instanceBuffer;
+	instanceBuffer.create(instancedVAO, 2, numInstances);
+	if (numInstances > 0)
+	{
+		// Lay the instances out on a square grid covering the screen
+		unsigned int gridSide = (unsigned int)std::ceil(std::sqrt((double)numInstances));
+		float cellSize = 2.0f / gridSide;
+		std::vector<InstanceData> instances(numInstances);
+		for (unsigned int i = 0; i < numInstances; i++)
+		{
+			InstanceData &instance = instances[i];
+			instance.offset[0] = -1.0f + (i % gridSide + 0.5f) * cellSize;
+			instance.offset[1] = -1.0f + (i / gridSide + 0.5f) * cellSize;
+			instance.scale = cellSize * 0.8f;
+			instance.rotation = (float)i * 0.1f;
+			instance.color[0] = (float)(i % gridSide) / gridSide;
+			instance.color[1] = (float)(i / gridSide) / gridSide;
+			instance.color[2] = 1.0f;
+			instance.color[3] = 1.0f;
+			instance.layer = i % (unsigned int)instanceLayers.getNumLayers();
+		}
+		instanceBuffer.update(instances.data(), numInstances);
+	}
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // uncomment to draw in WIREFRAME mode
 	// -----------------------------------------------------------
 
+	// Draws are queued as commands during the frame and issued sorted by state
+	RenderQueue renderQueue;
+
+	// Screen space quads for the HUD are batched, a whole layer takes a handful of draw calls
+	SpriteBatch spriteBatch;
+	spriteBatch.create();
+	std::vector<float> frameGraph(FRAME_GRAPH_SAMPLES, 0.0f);
+
+	// HUD images share an atlas page, together with a white texel for the solid shapes, so they all land in one batch
+	TextureAtlas hudAtlas;
+	const unsigned char whiteTexel[4] = { 255, 255, 255, 255 };
+	hudAtlas.addPixels("white", whiteTexel, 1, 1);
+	for (const std::string &spritePath : spritePaths)
+	{
+		hudAtlas.addImage(spritePath, spritePath);
+	}
+	bool hudAtlasBuilt = hudAtlas.build("hud_atlas.cache");
+
 	// Main loop
-	while (!glfwWindowShouldClose(window))
+	while (headless ? frameNumber < headlessFrames : !glfwWindowShouldClose(window))
 	{
+		CPU_PROFILE_ZONE("Frame");
+
 		// Check inputs
-		processInput(window);
+		if (window)
+		{
+			CPU_PROFILE_ZONE("processInput");
+			processInput(window);
+		}
+
+		// Swap in any shaders that were edited, their uniform handles have to be resolved again
+		if (shaderWatcher.update() > 0)
+		{
+			xOffsetHandle = shader.getUniformHandle("xOffset");
+			stateCache.invalidate(); // the old program is gone and its name may have been reused
+			stateCache.useProgram(shader.getID());
+			shader.setFloat(xOffsetHandle, xOffset);
+		}
+
+		gpuProfiler.beginFrame();
+		stateCache.beginFrame();
+
+		// Upload any textures the loader threads have finished decoding
+		gpuProfiler.beginZone("Texture uploads");
+		if (textureLoader.processUploads(TEXTURE_UPLOAD_BUDGET_MS) > 0)
+		{
+			stateCache.invalidateTextures(); // uploads bind textures directly
+		}
+		textureCache.update();
+		gpuProfiler.endZone();
+
+		// Update the shared uniform blocks
+		{
+			CPU_PROFILE_ZONE("Uniform updates");
+			double frameTime = headless ? frameNumber * HEADLESS_FRAME_TIME : glfwGetTime();
+			int framebufferWidth = offscreenTarget.getWidth(), framebufferHeight = offscreenTarget.getHeight();
+			if (!headless)
+			{
+				glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+			}
+			frameUniforms.time = (float)frameTime;
+			frameUniforms.delta_time = (float)(frameTime - lastFrameTime);
+			frameUniforms.frame_index += 1.0f;
+			frameUniforms.resolution[0] = (float)framebufferWidth;
+			frameUniforms.resolution[1] = (float)framebufferHeight;
+			frameUniforms.resolution[2] = framebufferWidth > 0 ? 1.0f / framebufferWidth : 0.0f;
+			frameUniforms.resolution[3] = framebufferHeight > 0 ? 1.0f / framebufferHeight : 0.0f;
+			lastFrameTime = frameTime;
+			gpuProfiler.beginZone("Uniform updates");
+			frameUniformBuffer.update(frameUniforms);
+			cameraUniformBuffer.update(cameraUniforms);
+			gpuProfiler.endZone();
+		}
 
 		// Render
+		if (headless)
+		{
+			offscreenTarget.bind(stateCache);
+		}
+		gpuProfiler.beginZone("Clear");
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);	//Clear screen with a grey/green color
 		glClear(GL_COLOR_BUFFER_BIT);			// Actually clear the screen
-		shader.useShader();
-
-		// Create a color change from red to black and back to red based on time
-		//float timeVal = glfwGetTime();
-		//float redValue = sin(timeVal) / 2.0f + 0.5f;
-		//int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-		//glUniform4f(vertexColorLocation, redValue, 0.0f, 0.0f, 1.0f);
-
-		//2. Set a horizontal offset via a uniform that we add to the vertex shader
-		float xOffset = 0.0f; //set triangle back to center but left this offset in
-		shader.setFloat("xOffset", xOffset);
+		gpuProfiler.endZone();
+
+		gpuProfiler.beginZone("Draw");
+		{
+			CPU_PROFILE_ZONE("Draw submission");
+
+			// Create a color change from red to black and back to red based on time
+			//float timeVal = glfwGetTime();
+			//float redValue = sin(timeVal) / 2.0f + 0.5f;
+			//int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
+			//glUniform4f(vertexColorLocation, redValue, 0.0f, 0.0f, 1.0f);
+
+			// Draw 2 triangles to form a rectangle with an EBO, the queue sorts every draw by state before issuing them
+			// The quad goes in the overlay pass so it always ends up on top of the instanced grid
+			renderQueue.submit(OVERLAY_PASS, shader.getID(), VAO, 0, quadIndices.getCount(), quadIndices.getType());
+			// The whole grid is one draw call, every quad reads its own transform, color and texture layer from the instance buffer
+			renderQueue.submitInstanced(OPAQUE_PASS, instancedShader.getID(), instancedVAO, instanceLayers.getID(), quadIndices.getCount(),
+				instanceBuffer.getNumInstances(), quadIndices.getType(), 0, GL_TRIANGLES, GL_TEXTURE_2D_ARRAY, samplerCache.get(gridSampler));
+			renderQueue.execute(stateCache);
+		}
+		gpuProfiler.endZone();
+
+		gpuProfiler.beginZone("HUD");
+		{
+			CPU_PROFILE_ZONE("HUD");
+			frameGraph[frameNumber % FRAME_GRAPH_SAMPLES] = frameUniforms.delta_time;
+
+			// Frame time graph in the top left corner, one bar per frame, a full bar is 33ms
+			const unsigned char background[4] = { 0, 0, 0, 160 };
+			const unsigned char barColor[4] = { 80, 220, 80, 255 };
+			const unsigned char spriteColor[4] = { 255, 255, 255, 255 };
+			const float noUV[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+			const AtlasRegion* white = hudAtlasBuilt ? hudAtlas.find("white") : NULL;
+			GLuint solidTexture = white ? hudAtlas.getPage(white->page).getID() : 0;
+			const float* solidUV = white ? white->uv : noUV;
+			spriteBatch.begin(stateCache, spriteShader, samplerCache.get(spriteSampler));
+			spriteBatch.draw(solidTexture, 8.0f, 8.0f, FRAME_GRAPH_SAMPLES * 2.0f + 4.0f, 68.0f, solidUV, background);
+			for (unsigned int i = 0; i < FRAME_GRAPH_SAMPLES; i++)
+			{
+				float barHeight = std::fmin(frameGraph[(frameNumber + 1 + i) % FRAME_GRAPH_SAMPLES] / 0.033f, 1.0f) * 64.0f;
+				spriteBatch.draw(solidTexture, 10.0f + i * 2.0f, 74.0f - barHeight, 2.0f, barHeight, solidUV, barColor);
+			}
+
+			// Atlas sprites in a row, 48 pixels high
+			float spriteX = 80.0f;
+			for (size_t i = 0; hudAtlasBuilt && i < spritePaths.size(); i++)
+			{
+				const AtlasRegion* region = hudAtlas.find(spritePaths[i]);
+				float spriteWidth = 48.0f * region->width / region->height;
+				spriteBatch.draw(hudAtlas.getPage(region->page).getID(), spriteX, 84.0f, spriteWidth, 48.0f, region->uv, spriteColor);
+				spriteX += spriteWidth + 4.0f;
+			}
+
+			// Thumbnail of the streamed in texture once it has arrived
+			const Texture* thumbnail = textureCache.get(containerTexture);
+			if (thumbnail)
+			{
+				spriteBatch.draw(*thumbnail, 8.0f, 84.0f, 64.0f, 64.0f);
+			}
+			spriteBatch.end();
+		}
+		gpuProfiler.endZone();
+
+		if (headless)
+		{
+			// Queue a copy of the finished frame and write out any earlier frames the GPU is done with
+			gpuProfiler.beginZone("Readback");
+			offscreenTarget.readback(frameNumber);
+			gpuProfiler.endZone();
+			gpuProfiler.endFrame();
+			offscreenTarget.collect(false);
+		}
+		else
+		{
+			gpuProfiler.endFrame();
+
+			// Check/call events and swap buffers
+			{
+				CPU_PROFILE_ZONE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
+			{
+				CPU_PROFILE_ZONE("glfwPollEvents");
+				glfwPollEvents();
+			}
+		}
+		frameNumber++;
+	}
 
-		// Draw a triangle
-		glBindVertexArray(VAO);				// Not really necessary to bind every loop since we only have a single VAO right now
-		//glDrawArrays(GL_TRIANGLES, 0, 3);	//Drawing a triangle, starting at index 0 of the bound array, drawing 3 vertices
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0); //Drawing 2 triangles to form a rectangle with an EBO
-		// glBindVertexArray(0);  //don't need to unbind every time
+	if (headless)
+	{
+		offscreenTarget.collect(true);
+		offscreenTarget.clearTarget();
+		std::cout << "Wrote " << frameNumber << " frames to " << outputPrefix << "_*" << std::endl;
+	}
 
-		// Check/call events and swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	gpuProfiler.printStats(std::cout);
+	if (spriteBatch.getNumFrames() > 0)
+	{
+		const SpriteBatchStats &spriteStats = spriteBatch.getTotalStats();
+		double frames = spriteBatch.getNumFrames();
+		std::cout << "Sprite batch: " << spriteStats.num_sprites / frames << " sprites in " << spriteStats.num_draw_calls / frames << " draw calls per frame ("
+			<< spriteStats.texture_breaks << " texture breaks, " << spriteStats.shader_breaks << " shader breaks, " << spriteStats.full_breaks << " full breaks, "
+			<< spriteStats.num_orphans << " buffer orphans, " << spriteStats.bytes_streamed / 1024 << " KB streamed)" << std::endl;
+	}
+	std::cout << "Texture cache: " << textureCache.getResidentBytes() / 1024 << " KB resident, " << textureCache.getNumEvictions()
+		<< " evictions, " << textureCache.getNumDroppedLevels() << " dropped mip levels" << std::endl;
+	std::cout << "Sampler cache: " << samplerCache.getNumSamplers() << " samplers shared by " << samplerCache.getNumRequests() << " requests" << std::endl;
+	std::cout << "GL state cache avoided " << stateCache.getAverageAvoidedCalls() << " redundant calls per frame" << std::endl;
+	if (!tracePath.empty())
+	{
+		CpuProfiler::writeChromeTrace(tracePath);
 	}
 
 	// Deallocate everything before program end
+	gpuProfiler.clearProfiler();
 	glDeleteVertexArrays(1, &VAO);
+	glDeleteVertexArrays(1, &instancedVAO);
+	instanceBuffer.clearBuffer();
+	instanceLayers.clearTexture();
+	spriteBatch.clearBatch();
+	hudAtlas.clearAtlas();
 	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	quadIndices.clearBuffer();
 
+	textureCache.clearCache();
+	samplerCache.clearCache();
+
+	uploadRing.clearRing();
+	frameUniformBuffer.clearBuffer();
+	cameraUniformBuffer.clearBuffer();
+	shaderWatcher.unwatch(&shader);
+	shaderWatcher.unwatch(&instancedShader);
+	shaderWatcher.unwatch(&spriteShader);
 	shader.clearShader();
-	glfwTerminate();
+	instancedShader.clearShader();
+	spriteShader.clearShader();
+	if (headlessContext.isCreated())
+	{
+		headlessContext.clearContext();
+	}
+	else
+	{
+		glfwTerminate();
+	}
 	return 0;
 }
 
@@ -161,7 +642,8 @@ int main()
 //	each time the window is resized
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	GLStateCache* stateCache = (GLStateCache*)glfwGetWindowUserPointer(window);
+	stateCache->setViewport(0, 0, width, height);
 }
 
 // Processes user input each frame
@@ -172,4 +654,13 @@ void processInput(GLFWwindow* window)
 	{
 		glfwSetWindowShouldClose(window, true);
 	}
+
+	// F12 dumps the recent CPU profiler zones, only once per key press
+	static bool traceKeyDown = false;
+	bool traceKeyPressed = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+	if (traceKeyPressed && !traceKeyDown)
+	{
+		CpuProfiler::writeChromeTrace("cpu_trace.json");
+	}
+	traceKeyDown = traceKeyPressed;
 }
\ No newline at end of file